@@ -0,0 +1,2528 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2022 - present Mikael Sundell.
+//
+
+#include "liblogctool_internal.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// imath
+#include <Imath/ImathVec.h>
+#include <Imath/half.h>
+
+// simd
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// openimageio
+#include <OpenImageIO/imageio.h>
+#include <OpenImageIO/filesystem.h>
+#include <OpenImageIO/hash.h>
+#include <OpenImageIO/sysutil.h>
+#include <OpenImageIO/strutil.h>
+#include <OpenImageIO/imagebufalgo.h>
+#include <OpenImageIO/parallel.h>
+
+using namespace OIIO;
+
+// opencolorio
+using namespace OCIO_NAMESPACE;
+
+// boost
+#include <boost/property_tree/json_parser.hpp>
+
+using namespace boost::property_tree;
+
+namespace logctool {
+
+// prints
+std::mutex print_mutex;
+std::ostream* info_stream = &std::cout;
+
+std::string datetime()
+{
+    std::time_t now = time(NULL);
+    if (const char* epoch = getenv("SOURCE_DATE_EPOCH")) {
+        now = (std::time_t)std::strtoll(epoch, nullptr, 10); // reproducible labels
+    }
+    struct tm tm;
+    Sysutil::get_local_time(&now, &tm);
+    char datetime[20];
+    strftime(datetime, 20, "%Y-%m-%d %H:%M:%S", &tm);
+    return std::string(datetime);
+}
+
+Imath::Vec3<float> hsv_to_rgb(const Imath::Vec3<float>& hsv) {
+    float hue = hsv.x;
+    float saturation = hsv.y;
+    float value = hsv.z;
+    if (hue < std::numeric_limits<float>::epsilon()) {
+        return Imath::Vec3<float>(0, 0, 0);
+    }
+    
+    int hi = static_cast<int>(std::floor(hue / 60.0f)) % 6;
+    float f = hue / 60.0f - static_cast<float>(hi);
+    float p = value * (1.0f - saturation);
+    float q = value * (1.0f - f * saturation);
+    float t = value * (1.0f - (1.0f - f) * saturation);
+
+    float r, g, b;
+    switch (hi) {
+        case 0: r = value; g = t; b = p; break;
+        case 1: r = q; g = value; b = p; break;
+        case 2: r = p; g = value; b = t; break;
+        case 3: r = p; g = q; b = value; break;
+        case 4: r = t; g = p; b = value; break;
+        case 5: r = value; g = p; b = q; break;
+    }
+
+    return Imath::Vec3<float>(r, g, b);
+}
+
+float pow_gamma(float value, float gamma) {
+    return pow(value, gamma);
+}
+
+int _10bit_to_int(int value)
+{
+    return (value >> 6); // bit shift by 6 for 10 bit representation
+}
+
+std::string float_to_str(float value, int precision)
+{
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(precision) << value;
+    return oss.str();
+}
+
+std::string percent_to_str(float value)
+{
+    std::ostringstream oss;
+    oss << static_cast<int>(value * 100) << '%';
+    return oss.str();
+}
+
+std::string int_to_str(int value)
+{
+    return std::to_string(value);
+}
+
+std::string _10bit_to_str(int value)
+{
+    return std::to_string(_10bit_to_int(value)); // 10bit stored 16bit and bitshifted for strings
+}
+
+std::string program_path(const std::string& path)
+{
+    return Filesystem::parent_path(Sysutil::this_program_path()) + path;
+}
+
+static std::string resources_root;
+
+std::string font_path(const std::string& font)
+{
+    if (resources_root.size()) {
+        return resources_root + "/fonts/" + font;
+    }
+    return Filesystem::parent_path(Sysutil::this_program_path()) + "/fonts/" + font;
+}
+
+std::string resources_path(const std::string& resource)
+{
+    if (resources_root.size()) {
+        return resources_root + "/resources/" + resource;
+    }
+    return Filesystem::parent_path(Sysutil::this_program_path()) + "/resources/" + resource;
+}
+
+Imath::Vec3<float> mult_matrix(const Imath::Vec3<float>& src, const Imath::Matrix33<float>& matrix) {
+    return src * matrix.transposed(); // imath row-order from column-order convention
+}
+
+// Color space and conversions, with support for illuminants and white point adaptation.
+// https://github.com/mikaelsundell/colortool
+Imath::Vec3<float> lab_to_d50(const Imath::Vec3<float>& src) {
+    const double Xn = 0.9642;
+    const double Yn = 1.00000;
+    const double Zn = 0.8251;
+    double fy = (src.x + 16.0) / 116.0;
+    double fx = fy + (src.y / 500.0);
+    double fz = fy - (src.z / 200.0);
+    double fx3 = std::pow(fx, 3.0);
+    double fz3 = std::pow(fz, 3.0);
+    float X = (fx3 > 0.008856) ? fx3 : ((fx - 16.0 / 116.0) / 7.787);
+    float Y = (src.x > 8.0) ? std::pow(((src.x + 16.0) / 116.0), 3.0) : (src.x / 903.3);
+    float Z = (fz3 > 0.008856) ? fz3 : ((fz - 16.0 / 116.0) / 7.787);
+    X *= Xn;
+    Y *= Yn;
+    Z *= Zn;
+    return Imath::Vec3<float>(X, Y, Z);
+}
+
+Imath::Vec3<float> d50_to_d65(const Imath::Vec3<float>& src) {
+    Imath::Matrix33<float> matrix(
+      0.9555766f, -0.0230393f, 0.0631636f,
+      -0.0282895f, 1.0099416f, 0.0210077f,
+      0.0122982f, -0.020483f, 1.3299098f);
+    return mult_matrix(src, matrix);
+}
+
+Imath::Vec3<float> d65_to_d50(const Imath::Vec3<float>& src) {
+    Imath::Matrix33<float> matrix(
+      1.0478112f, 0.0228866f, -0.0501270f,
+      0.0295424f, 0.9904844f, -0.0170491f,
+      -0.0092345f, 0.0150436f, 0.7521316f);
+    return mult_matrix(src, matrix);
+}
+
+Imath::Vec3<float> d50_to_lab(const Imath::Vec3<float>& src) {
+    const double Xn = 0.9642;
+    const double Yn = 1.00000;
+    const double Zn = 0.8251;
+    auto f = [](double t) -> double {
+        return (t > 0.008856) ? std::cbrt(t) : (7.787 * t + 16.0 / 116.0);
+    };
+    double fx = f(src.x / Xn);
+    double fy = f(src.y / Yn);
+    double fz = f(src.z / Zn);
+    return Imath::Vec3<float>(116.0 * fy - 16.0, 500.0 * (fx - fy), 200.0 * (fy - fz));
+}
+
+float delta_e(const Imath::Vec3<float>& lab1, const Imath::Vec3<float>& lab2) {
+    float dl = lab1.x - lab2.x;
+    float da = lab1.y - lab2.y;
+    float db = lab1.z - lab2.z;
+    return std::sqrt(dl * dl + da * da + db * db); // cie76
+}
+
+// logc3 colorspace
+bool logc3_colorspace(int ei, LogC3Colorspace& colorspace)
+{
+    return logc3_curve(ei, [&](auto curve) {
+        colorspace = curve.colorspace();
+    });
+}
+
+// patch
+std::vector<Patch> load_patches(const std::string& jsonfile)
+{
+    std::vector<Patch> patches;
+    std::ifstream json(jsonfile);
+    if (!json.is_open()) {
+        print_error("could not open colorpatches file: ", jsonfile);
+        return patches;
+    }
+    ptree pt;
+    read_json(jsonfile, pt);
+    for (const auto& item : pt) {
+        const ptree& data = item.second;
+        Patch patch;
+        patch.name = data.get<std::string>("name", "");
+        patch.cieLabd50_l = data.get<float>("CIE L*a*b*.L*", 0.0f);
+        patch.cieLabd50_a = data.get<float>("CIE L*a*b*.a*", 0.0f);
+        patch.cieLabd50_b = data.get<float>("CIE L*a*b*.b*", 0.0f);
+        // optional
+        patch.sRGB_r = data.get<float>("sRGB.R", 0.0f);
+        patch.sRGB_g = data.get<float>("sRGB.G", 0.0f);
+        patch.sRGB_b = data.get<float>("sRGB.B", 0.0f);
+        std::string munsell_hue = data.get<std::string>("Munsell Notation.Hue", "");
+        patch.munsell_hue = 0.0f;
+        if (!munsell_hue.empty()) {
+            size_t space_pos = munsell_hue.find(' ');
+            if (space_pos != std::string::npos) {
+                std::string hue_numeric = munsell_hue.substr(0, space_pos);
+                try {
+                    patch.munsell_hue = std::stof(hue_numeric);
+                } catch (...) {
+                    patch.munsell_hue = 0.0f;
+                }
+            }
+        }
+        patch.munsell_value = data.get<float>("Munsell Notation.Value", 0.0f);
+        patch.munsell_chroma = data.get<float>("Munsell Notation.Chroma", 0.0f);
+        patches.push_back(patch);
+    }
+    return patches;
+}
+
+// patch layout
+static void patch_sizes(int width, int height, float spacing, PatchLayout& layout)
+{
+    int colorswidth = width * 0.8;
+    layout.patchwidth = (colorswidth - (layout.patchcols + 1) * spacing) / layout.patchcols;
+    layout.patchheight = ((height - height * 0.05) - (layout.patchrows + 1) * spacing) / layout.patchrows;
+    layout.spacing = spacing;
+    layout.referencex = colorswidth;
+    layout.referenceheight = ((height - height * 0.05f) - (2 + 1) * spacing) / 2;
+    layout.sizecode = height * 0.015f;
+}
+
+bool patch_layout(const std::string& outputtype, int width, int height, PatchLayout& layout)
+{
+    if (outputtype == "classic") {
+        layout.patchfile = resources_path("classic.json");
+        layout.patchrows = 4;
+        layout.patchcols = 6;
+        layout.white_index = 18;
+        layout.black_index = 23;
+        layout.row_order = true;
+        layout.sizelabel = height * 0.025f;
+    }
+    else if (outputtype == "digitalsg") {
+        layout.patchfile = resources_path("digitalsg.json");
+        layout.patchrows = 10;
+        layout.patchcols = 14;
+        layout.white_index = 0;
+        layout.black_index = 20;
+        layout.row_order = false;
+        layout.sizelabel = height * 0.008f;
+    }
+    else {
+        return false;
+    }
+    layout.patchcount = layout.patchrows * layout.patchcols;
+    patch_sizes(width, height, width * 0.02f, layout);
+    return true;
+}
+
+bool patch_grid(const std::vector<Patch>& patches, int width, int height, PatchLayout& layout)
+{
+    if (patches.empty()) {
+        return false;
+    }
+    // near square patches in the colors area, row order
+    const int count = patches.size();
+    const float aspect = (width * 0.8f) / (height * 0.95f);
+    layout.patchcols = std::max(1, (int)std::round(std::sqrt(count * aspect)));
+    layout.patchrows = (count + layout.patchcols - 1) / layout.patchcols;
+    layout.patchcount = count;
+    layout.row_order = true;
+    layout.sizelabel = height * 0.1f / layout.patchrows;
+    
+    // references are the lightest and darkest patch
+    layout.white_index = 0;
+    layout.black_index = 0;
+    for (int i = 1; i < count; i++) {
+        if (patches[i].cieLabd50_l > patches[layout.white_index].cieLabd50_l) {
+            layout.white_index = i;
+        }
+        if (patches[i].cieLabd50_l < patches[layout.black_index].cieLabd50_l) {
+            layout.black_index = i;
+        }
+    }
+    // spacing follows the cell pitch, a fixed spacing leaves no room for many columns
+    const float pitch = std::min((width * 0.8f) / layout.patchcols, (height * 0.95f) / layout.patchrows);
+    patch_sizes(width, height, std::max(1.0f, std::min(width * 0.02f, pitch * 0.1f)), layout);
+    return true;
+}
+
+
+ROI patch_roi(const PatchLayout& layout, int row, int col)
+{
+    const int x0 = col * (layout.patchwidth + layout.spacing) + layout.spacing;
+    const int y0 = row * (layout.patchheight + layout.spacing) + layout.spacing;
+    return ROI(x0, x0 + layout.patchwidth, y0, y0 + layout.patchheight);
+}
+
+ROI reference_roi(const PatchLayout& layout, int width, int i)
+{
+    const int y0 = i * (layout.referenceheight + layout.spacing) + layout.spacing;
+    return ROI(layout.referencex, width - layout.spacing, y0, y0 + layout.referenceheight - 1);
+}
+
+std::vector<PatchRect> patch_rects(const PatchLayout& layout, int width)
+{
+    std::vector<PatchRect> rects;
+    rects.reserve(layout.patchcount + 2);
+    for (int row = 0; row < layout.patchrows; ++row) {
+        for (int col = 0; col < layout.patchcols; ++col) {
+            const int no = patch_index(layout, row, col);
+            if (no >= 0) {
+                rects.push_back(PatchRect { no, patch_roi(layout, row, col) });
+            }
+        }
+    }
+    rects.push_back(PatchRect { layout.white_index, reference_roi(layout, width, 0) });
+    rects.push_back(PatchRect { layout.black_index, reference_roi(layout, width, 1) });
+    return rects;
+}
+
+int patch_index(const PatchLayout& layout, int row, int col)
+{
+    const int index = layout.row_order ? (row * layout.patchcols + col)
+                                       : (col * layout.patchrows + row);
+    return index < layout.patchcount ? index : -1;
+}
+
+template <typename Curve>
+static Imath::Vec3<float> curve_patch_color(
+    const Patch& patch,
+    const LogC3Colorspace& colorspace,
+    const Curve& curve,
+    bool outputlinear,
+    const ConstCPUProcessorRcPtr& transformProcessor,
+    float gain
+) {
+    Imath::Vec3<float> xyz =
+        d50_to_d65(lab_to_d50(Imath::Vec3<float>(
+            patch.cieLabd50_l, patch.cieLabd50_a, patch.cieLabd50_b)));
+
+    Imath::Vec3<float> awg = colorspace.xyz_from_awg3(xyz) * gain; // exposure in scene linear
+    Imath::Vec3<float> out =
+        outputlinear
+            ? awg
+            : Imath::Vec3<float>(curve.lin2log(awg.x),
+                                 curve.lin2log(awg.y),
+                                 curve.lin2log(awg.z));
+
+    if (transformProcessor) {
+        float rgb[3] = { out.x, out.y, out.z };
+        transformProcessor->applyRGB(rgb);
+        out.setValue(rgb[0], rgb[1], rgb[2]);
+    }
+    return out;
+}
+
+Imath::Vec3<float> patch_color(
+    const Patch& patch,
+    LogC3Colorspace& colorspace,
+    bool outputlinear,
+    const ConstCPUProcessorRcPtr& transformProcessor,
+    float gain
+) {
+    return curve_patch_color(patch, colorspace, colorspace, outputlinear, transformProcessor, gain);
+}
+
+// data format
+bool data_format(const std::string& name, DataFormat& format)
+{
+    format.name = name;
+    format.is10bit = false;
+    if (name == "float") {
+        format.typedesc = TypeDesc::FLOAT;
+    }
+    else if (name == "half") {
+        format.typedesc = TypeDesc::HALF;
+    }
+    else if (name == "uint8") {
+        format.typedesc = TypeDesc::UINT8;
+    }
+    else if (name == "uint10") {
+        format.typedesc = TypeDesc::UINT16;
+        format.is10bit = true; // 10bit stored 16bit and bitshifted in formats like DPX
+    }
+    else if (name == "uint16") {
+        format.typedesc = TypeDesc::UINT16;
+    }
+    else if (name == "uint32") {
+        format.typedesc = TypeDesc::UINT32;
+    }
+    else {
+        return false;
+    }
+    format.typelimit = pow(2, format.typedesc.size() * 8) - 1;
+    return true;
+}
+
+int value_to_code(float value, const DataFormat& format)
+{
+    value = std::max(0.0f, std::min(1.0f, value));
+    return (int)std::lround(value * format.typelimit);
+}
+
+std::string code_to_str(float value, const DataFormat& format)
+{
+    if (format.typedesc.is_floating_point()) {
+        return float_to_str(value);
+    }
+    int code = value_to_code(value, format);
+    return format.is10bit ? _10bit_to_str(code) : int_to_str(code);
+}
+
+std::string code_to_str(const Imath::Vec3<float>& out, const DataFormat& format)
+{
+    return code_to_str(out.x, format) + ", "
+         + code_to_str(out.y, format) + ", "
+         + code_to_str(out.z, format);
+}
+
+std::string signal_to_str(float value, const DataFormat& format)
+{
+    if (format.typedesc.is_floating_point()) {
+        return percent_to_str(value);
+    }
+    int code = value_to_code(value, format);
+    if (format.is10bit) {
+        return percent_to_str((float)_10bit_to_int(code) / (pow(2, 10) - 1));
+    }
+    return percent_to_str(code / format.typelimit);
+}
+
+// half conversion
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define LOGCTOOL_F16C 1
+__attribute__((target("avx,f16c")))
+static size_t float_to_half_f16c(const float* src, uint16_t* dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 values = _mm256_loadu_ps(src + i);
+        __m128i halfs = _mm256_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm_storeu_si128((__m128i*)(dst + i), halfs);
+    }
+    return i;
+}
+#endif
+
+void float_to_half(const float* src, uint16_t* dst, size_t count)
+{
+    size_t i = 0;
+#if defined(LOGCTOOL_F16C)
+    static const bool f16c = __builtin_cpu_supports("f16c") && __builtin_cpu_supports("avx");
+    if (f16c) {
+        i = float_to_half_f16c(src, dst, count);
+    }
+#elif defined(__aarch64__)
+    for (; i + 4 <= count; i += 4) {
+        float16x4_t halfs = vcvt_f16_f32(vld1q_f32(src + i));
+        vst1_u16(dst + i, vreinterpret_u16_f16(halfs));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = Imath::half(src[i]).bits(); // scalar remainder
+    }
+}
+
+static bool contiguous(const ImageBuf& imageBuf)
+{
+    // local pixels without padding, rows are addressed directly
+    const ImageSpec& spec = imageBuf.spec();
+    return imageBuf.localpixels()
+        && imageBuf.pixel_stride() == (stride_t)spec.pixel_bytes()
+        && imageBuf.scanline_stride() == (stride_t)spec.scanline_bytes();
+}
+
+static bool convert_to_half(ImageBuf& halfBuf, const ImageBuf& imageBuf)
+{
+    if (!contiguous(halfBuf) || !contiguous(imageBuf)) {
+        return false;
+    }
+    const ImageSpec& spec = imageBuf.spec();
+    const size_t rowsize = (size_t)spec.width * spec.nchannels;
+    const float* src = (const float*)imageBuf.localpixels();
+    uint16_t* dst = (uint16_t*)halfBuf.localpixels();
+    parallel_for(0, spec.height, [&](int64_t y) {
+        float_to_half(src + y * rowsize, dst + y * rowsize, rowsize);
+    });
+    return true;
+}
+
+// buffer pool
+static const size_t pool_limit = size_t(1) << 30; // cached bytes kept for reuse
+
+struct BufferPool
+{
+    std::mutex mutex;
+    std::multimap<size_t, void*> buffers;
+    size_t bytes = 0;
+};
+
+static BufferPool& buffer_pool()
+{
+    // never destroyed, buffers may be released during static destruction
+    static BufferPool* pool = new BufferPool();
+    return *pool;
+}
+
+static size_t size_class(size_t bytes)
+{
+    // powers of two up to 1 mb, then 1 mb steps
+    const size_t mb = size_t(1) << 20;
+    if (bytes >= mb) {
+        return (bytes + mb - 1) / mb * mb;
+    }
+    size_t size = 4096;
+    while (size < bytes) {
+        size <<= 1;
+    }
+    return size;
+}
+
+static void zero_buffer(void* data, size_t size)
+{
+    // parallel first touch, pages are faulted in by all threads
+    const size_t chunk = size_t(1) << 20;
+    char* bytes = (char*)data;
+    parallel_for(0, (int64_t)((size + chunk - 1) / chunk), [&](int64_t i) {
+        const size_t begin = i * chunk;
+        memset(bytes + begin, 0, std::min(chunk, size - begin));
+    });
+}
+
+std::shared_ptr<void> pool_buffer(size_t bytes)
+{
+    BufferPool& pool = buffer_pool();
+    const size_t size = size_class(bytes);
+    void* data = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        auto it = pool.buffers.find(size);
+        if (it != pool.buffers.end()) {
+            data = it->second;
+            pool.buffers.erase(it);
+            pool.bytes -= size;
+        }
+    }
+    if (!data) {
+        data = std::malloc(size);
+        if (!data) {
+            return std::shared_ptr<void>();
+        }
+        zero_buffer(data, size);
+    }
+    return std::shared_ptr<void>(data, [size](void* data) {
+        BufferPool& pool = buffer_pool();
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            if (pool.bytes + size <= pool_limit) {
+                pool.buffers.emplace(size, data);
+                pool.bytes += size;
+                return;
+            }
+        }
+        std::free(data);
+    });
+}
+
+std::shared_ptr<void> pool_image(ImageBuf& imageBuf, const ImageSpec& spec, bool zero)
+{
+    const size_t bytes = spec.image_bytes();
+    std::shared_ptr<void> buffer = pool_buffer(bytes);
+    if (!buffer) {
+        imageBuf.reset(spec);
+        return buffer;
+    }
+    if (zero) {
+        zero_buffer(buffer.get(), bytes);
+    }
+    imageBuf.reset(spec, buffer.get());
+    return buffer;
+}
+
+// mapped read, uncompressed dpx is decoded from the page cache without an intermediate copy
+static uint32_t dpx_u32(const unsigned char* data, bool bigendian)
+{
+    return bigendian
+        ? (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3]
+        : (uint32_t)data[3] << 24 | (uint32_t)data[2] << 16 | (uint32_t)data[1] << 8 | data[0];
+}
+
+static uint16_t dpx_u16(const unsigned char* data, bool bigendian)
+{
+    return bigendian
+        ? (uint16_t)(data[0] << 8 | data[1])
+        : (uint16_t)(data[1] << 8 | data[0]);
+}
+
+static bool decode_dpx(const unsigned char* data, size_t size, ImageBuf& imageBuf, std::shared_ptr<void>& buffer)
+{
+    if (size < 2048) {
+        return false;
+    }
+    bool bigendian;
+    if (std::memcmp(data, "SDPX", 4) == 0) {
+        bigendian = true;
+    } else if (std::memcmp(data, "XPDS", 4) == 0) {
+        bigendian = false;
+    } else {
+        return false;
+    }
+    // single rgb element, top to bottom, no run length encoding
+    const uint16_t orientation = dpx_u16(data + 768, bigendian);
+    const uint16_t elements = dpx_u16(data + 770, bigendian);
+    const int width = (int)dpx_u32(data + 772, bigendian);
+    const int height = (int)dpx_u32(data + 776, bigendian);
+    const unsigned char* element = data + 780;
+    const uint8_t descriptor = element[20];
+    const uint8_t bitsize = element[23];
+    const uint16_t packing = dpx_u16(element + 24, bigendian);
+    const uint16_t encoding = dpx_u16(element + 26, bigendian);
+    const uint32_t offset = dpx_u32(element + 28, bigendian);
+    uint32_t eolpadding = dpx_u32(element + 32, bigendian);
+    if (eolpadding == 0xFFFFFFFF) {
+        eolpadding = 0;
+    }
+    if (orientation != 0 || elements != 1 || encoding != 0 || width <= 0 || height <= 0) {
+        return false;
+    }
+    int nchannels;
+    size_t pixelbytes;
+    if (bitsize == 10 && descriptor == 50 && (packing == 1 || packing == 2)) {
+        nchannels = 3;
+        pixelbytes = 4;
+    } else if (bitsize == 16 && (descriptor == 50 || descriptor == 51) && (packing == 0 || packing == 1)) {
+        nchannels = descriptor == 50 ? 3 : 4;
+        pixelbytes = nchannels * 2;
+    } else {
+        return false;
+    }
+    // header values are untrusted, checked without overflow before allocating
+    if ((size_t)width > (std::numeric_limits<size_t>::max() - eolpadding) / pixelbytes) {
+        return false;
+    }
+    const size_t linebytes = width * pixelbytes + eolpadding;
+    if (offset < 2048 || offset > size || (size_t)height > (size - offset) / linebytes) {
+        return false;
+    }
+    
+    // decoded straight into a pooled float buffer, as read(FLOAT) would, 10 bit codes widen to 16 bit first
+    ImageSpec spec(width, height, nchannels, TypeDesc::FLOAT);
+    buffer = pool_image(imageBuf, spec);
+    float* pixels = static_cast<float*>(imageBuf.localpixels());
+    const unsigned char* lines = data + offset;
+    parallel_for(0, (int64_t)height, [&](int64_t y) {
+        const unsigned char* line = lines + linebytes * y;
+        float* out = pixels + (size_t)width * nchannels * y;
+        if (bitsize == 10) {
+            // filled method a pads the low bits, method b the high bits
+            const int shift = packing == 1 ? 2 : 0;
+            const float scale = 1.0f / 65535.0f;
+            auto widen = [](uint32_t code) { return (float)(code << 6 | code >> 4); };
+            for (int x = 0; x < width; x++) {
+                const uint32_t word = dpx_u32(line + x * 4, bigendian) >> shift;
+                out[x * 3] = widen((word >> 20) & 0x3FF) * scale;
+                out[x * 3 + 1] = widen((word >> 10) & 0x3FF) * scale;
+                out[x * 3 + 2] = widen(word & 0x3FF) * scale;
+            }
+        } else {
+            const float scale = 1.0f / 65535.0f;
+            const int count = width * nchannels;
+            for (int i = 0; i < count; i++) {
+                out[i] = (float)dpx_u16(line + i * 2, bigendian) * scale;
+            }
+        }
+    });
+    return true;
+}
+
+bool read_mapped(const std::string& filename, ImageBuf& imageBuf, std::shared_ptr<void>& buffer)
+{
+#if !defined(_WIN32)
+    if (Strutil::lower(Filesystem::extension(filename)) != ".dpx") {
+        return false;
+    }
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    const size_t size = st.st_size;
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+    bool decoded = decode_dpx(static_cast<const unsigned char*>(data), size, imageBuf, buffer);
+    munmap(data, size);
+    return decoded;
+#else
+    return false;
+#endif
+}
+
+// trace
+struct TraceEvent
+{
+    const char* name;
+    const char* category;
+    std::string job;
+    std::string chart;
+    std::string detail;
+    int tid;
+    int64_t start;
+    int64_t duration;
+};
+
+struct TraceState
+{
+    std::atomic<bool> enabled { false };
+    std::chrono::steady_clock::time_point origin;
+    std::atomic<int> threads { 0 };
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+    std::map<int, std::string> names;
+};
+
+struct TraceThread
+{
+    int tid = -1;
+    TraceJob job;
+};
+
+static TraceState& trace_state()
+{
+    // never destroyed, spans may end during static destruction
+    static TraceState* state = new TraceState();
+    return *state;
+}
+
+static TraceThread& trace_thread_state()
+{
+    static thread_local TraceThread thread;
+    if (thread.tid < 0) {
+        thread.tid = trace_state().threads++;
+    }
+    return thread;
+}
+
+static int64_t trace_now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - trace_state().origin).count();
+}
+
+static std::string trace_escape(const std::string& value)
+{
+    std::string escaped;
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if ((unsigned char)c < 0x20) {
+            escaped += ' ';
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+void trace_enable()
+{
+    TraceState& state = trace_state();
+    state.origin = std::chrono::steady_clock::now();
+    state.enabled = true;
+}
+
+bool trace_enabled()
+{
+    return trace_state().enabled;
+}
+
+void trace_thread(const std::string& name)
+{
+    if (!trace_enabled()) {
+        return;
+    }
+    TraceState& state = trace_state();
+    const int tid = trace_thread_state().tid;
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.names[tid] = name;
+}
+
+TraceJob trace_job()
+{
+    return trace_thread_state().job;
+}
+
+void trace_job(const TraceJob& job)
+{
+    trace_thread_state().job = job;
+}
+
+TraceSpan::TraceSpan(const char* name, const char* category, const std::string& detail)
+: name(name)
+, category(category)
+, start(-1)
+{
+    if (trace_enabled()) {
+        this->detail = detail;
+        start = trace_now();
+    }
+}
+
+TraceSpan::~TraceSpan()
+{
+    if (start < 0) {
+        return;
+    }
+    TraceState& state = trace_state();
+    const TraceThread& thread = trace_thread_state();
+    TraceEvent event { name, category, thread.job.job, thread.job.chart, detail, thread.tid, start, trace_now() - start };
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.events.push_back(std::move(event));
+}
+
+bool write_trace(const std::string& filename)
+{
+    std::ofstream outputFile(filename);
+    if (!outputFile) {
+        return false;
+    }
+    TraceState& state = trace_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    // chrome trace event format, complete events and thread names
+    outputFile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+    bool first = true;
+    for (const std::pair<const int, std::string>& name : state.names) {
+        outputFile << (first ? "" : ",\n")
+                   << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << name.first
+                   << ",\"args\":{\"name\":\"" << trace_escape(name.second) << "\"}}";
+        first = false;
+    }
+    for (const TraceEvent& event : state.events) {
+        outputFile << (first ? "" : ",\n")
+                   << "{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category << "\""
+                   << ",\"ph\":\"X\",\"ts\":" << event.start << ",\"dur\":" << event.duration
+                   << ",\"pid\":1,\"tid\":" << event.tid
+                   << ",\"args\":{\"job\":\"" << trace_escape(event.job) << "\""
+                   << ",\"chart\":\"" << trace_escape(event.chart) << "\"";
+        if (event.detail.size()) {
+            outputFile << ",\"detail\":\"" << trace_escape(event.detail) << "\"";
+        }
+        outputFile << "}}";
+        first = false;
+    }
+    outputFile << std::endl << "]}" << std::endl;
+    return true;
+}
+
+static ConstCPUProcessorRcPtr quantize_processor(BitDepth bitdepth, OptimizationFlags optimization)
+{
+    // identity with explicit bit depths, ocio packs and rounds in its optimized path
+    static std::mutex mutex;
+    static std::map<std::pair<int, unsigned long>, ConstCPUProcessorRcPtr> processors;
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::pair<int, unsigned long> key((int)bitdepth, (unsigned long)optimization);
+    auto it = processors.find(key);
+    if (it != processors.end()) {
+        return it->second;
+    }
+    ConstCPUProcessorRcPtr processor;
+    try {
+        ConstConfigRcPtr config = Config::CreateRaw();
+        processor = config->getProcessor(MatrixTransform::Create())
+            ->getOptimizedCPUProcessor(BIT_DEPTH_F32, bitdepth, optimization);
+    } catch (const Exception&) {
+        processor = ConstCPUProcessorRcPtr();
+    }
+    processors[key] = processor;
+    return processor;
+}
+
+bool quantize_image(ImageBuf& dst, const ImageBuf& src, const DataFormat& format, OptimizationFlags optimization)
+{
+    // float master to output data format, labels are rendered after
+    const ImageSpec& srcspec = src.spec();
+    if (!dst.initialized()) {
+        ImageSpec spec = srcspec;
+        spec.set_format(format.typedesc);
+        dst.reset(spec);
+    }
+    else {
+        // caller-owned, never written past its spec
+        const ImageSpec& dstspec = dst.spec();
+        if (dstspec.x != srcspec.x || dstspec.y != srcspec.y
+            || dstspec.width != srcspec.width || dstspec.height != srcspec.height
+            || dstspec.nchannels != srcspec.nchannels || dstspec.format != format.typedesc) {
+            dst.errorfmt("image does not match chart, expected {}x{}+{}+{}, {} channels, {}",
+                         srcspec.width, srcspec.height, srcspec.x, srcspec.y,
+                         srcspec.nchannels, format.name);
+            return false;
+        }
+    }
+    if (format.is10bit) {
+        dst.specmod().attribute("oiio:BitsPerSample", 10);
+    }
+    if (format.typedesc == TypeDesc::HALF && convert_to_half(dst, src)) {
+        return true;
+    }
+    // 8 and 16 bit, 10 bit is stored 16 bit, in one ocio pass over packed rows
+    const ImageSpec& spec = src.spec();
+    const BitDepth bitdepth = format.typedesc == TypeDesc::UINT8 ? BIT_DEPTH_UINT8
+                            : format.typedesc == TypeDesc::UINT16 ? BIT_DEPTH_UINT16
+                            : BIT_DEPTH_UNKNOWN;
+    void* dstpixels = dst.localpixels();
+    const float* srcpixels = (const float*)src.localpixels();
+    if (bitdepth != BIT_DEPTH_UNKNOWN && contiguous(dst) && contiguous(src)
+        && (spec.nchannels == 3 || spec.nchannels == 4)) {
+        ConstCPUProcessorRcPtr processor = quantize_processor(bitdepth, optimization);
+        if (processor) {
+            const size_t rowsize = (size_t)spec.width * spec.nchannels;
+            const size_t typesize = format.typedesc.size();
+            parallel_for(0, (int64_t)spec.height, [&](int64_t y) {
+                PackedImageDesc srcdesc((void*)(srcpixels + y * rowsize), spec.width, 1, spec.nchannels);
+                PackedImageDesc dstdesc((char*)dstpixels + y * rowsize * typesize, spec.width, 1,
+                                        spec.nchannels == 4 ? CHANNEL_ORDERING_RGBA : CHANNEL_ORDERING_RGB,
+                                        bitdepth, typesize, typesize * spec.nchannels, typesize * rowsize);
+                processor->apply(srcdesc, dstdesc);
+            });
+            return true;
+        }
+    }
+    return ImageBufAlgo::copy(dst, src);
+}
+
+bool write_image(const ImageBuf& imageBuf, const std::string& filename)
+{
+    print_info("writing output file: ", filename);
+    
+    if (!imageBuf.write(filename)) {
+        print_error("could not write file: ", imageBuf.geterror());
+        return false;
+    }
+    return true;
+}
+
+// sidecar
+ptree sidecar_code(
+    const Imath::Vec3<float>& out,
+    const DataFormat& format
+) {
+    ptree pt;
+    pt.add_child("value", sidecar_array(std::vector<float> { out.x, out.y, out.z }));
+    if (!format.typedesc.is_floating_point()) {
+        std::vector<int> codes;
+        for (int c = 0; c < 3; c++) {
+            int code = value_to_code(out[c], format);
+            codes.push_back(format.is10bit ? _10bit_to_int(code) : code);
+        }
+        pt.add_child("code", sidecar_array(codes));
+    }
+    return pt;
+}
+
+ptree sidecar_patch(
+    const Patch& patch,
+    const ROI& roi,
+    const Imath::Vec3<float>& out,
+    const DataFormat& format
+) {
+    ptree pt = sidecar_code(out, format);
+    pt.put("name", patch.name);
+    pt.put("x", roi.xbegin);
+    pt.put("y", roi.ybegin);
+    pt.put("width", roi.width());
+    pt.put("height", roi.height());
+    pt.add_child("lab", sidecar_array(std::vector<float> {
+        patch.cieLabd50_l, patch.cieLabd50_a, patch.cieLabd50_b }));
+    return pt;
+}
+
+bool write_sidecar(const std::string& filename, const ptree& pt)
+{
+    std::ofstream outputFile(filename);
+    if (!outputFile) {
+        return false;
+    }
+    write_json(outputFile, pt);
+    return true;
+}
+
+// gray value
+float gray_value(float log, const ConstCPUProcessorRcPtr& transformProcessor)
+{
+    if (transformProcessor) {
+        float rgb[3] = { log, log, log };
+        transformProcessor->applyRGB(rgb);
+        return rgb[0];
+    }
+    return log;
+}
+
+static float background_value(
+    LogC3Colorspace& colorspace,
+    bool outputlinear,
+    const ConstCPUProcessorRcPtr& transformProcessor
+) {
+    float log = outputlinear ? 0.0f : colorspace.lin2log(0.0f);
+    return gray_value(log, transformProcessor);
+}
+
+// region
+bool clip_roi(const ImageBuf& imageBuf, ROI& roi)
+{
+    // chart layout is global, a region only renders its data window
+    roi = roi_intersection(roi, imageBuf.roi());
+    return roi.width() > 0 && roi.height() > 0;
+}
+
+bool strip_roi(int width, int height, int strip, int strips, ROI& roi)
+{
+    if (strips < 1 || strip < 0 || strip >= strips) {
+        return false;
+    }
+    roi = ROI(0, width, (int)((int64_t)height * strip / strips), (int)((int64_t)height * (strip + 1) / strips));
+    return roi.height() > 0;
+}
+
+// stepchart
+std::vector<StepStop> stepchart_stops(
+    int width,
+    float midgray,
+    LogC3Colorspace& colorspace,
+    bool outputlinear,
+    const ConstCPUProcessorRcPtr& transformProcessor
+) {
+    const int signalsize = 17;
+    const int stopwidth = std::max(1, (int)floor(width / signalsize));
+    std::vector<StepStop> stops;
+    for(int s=0; s<signalsize; s++) {
+        StepStop step;
+        step.stop = s-8;
+        step.x = s * stopwidth + stopwidth/2;
+        step.lin = pow(2, step.stop) * midgray;
+        step.log = outputlinear ? step.lin : colorspace.lin2log(step.lin);
+        step.value = gray_value(step.log, transformProcessor);
+        stops.push_back(step);
+    }
+    return stops;
+}
+
+ROI stepchart_roi(int width, int height, int signalsize, int s)
+{
+    const int stopwidth = std::max(1, (int)floor(width / signalsize));
+    return ROI(s * stopwidth, (s + 1) * stopwidth, 0, height / 2);
+}
+
+static void render_stepchart(
+    ImageBuf& imageBuf,
+    const std::vector<StepStop>& stops,
+    LogC3Colorspace& colorspace,
+    float midgray,
+    bool outputlinear,
+    const ConstCPUProcessorRcPtr& transformProcessor
+) {
+    const int width = imageBuf.spec().full_width;
+    const int height = imageBuf.spec().full_height;
+    const int channels = imageBuf.nchannels();
+    const int signalsize = stops.size();
+    const int stopwidth = std::max(1, (int)floor(width / signalsize));
+    
+    // data window in chart coordinates, all of the chart unless a region
+    const ROI roi = imageBuf.roi();
+    const int roiwidth = roi.width();
+    
+    // continuous ramp, every row in the lower half is the same
+    std::vector<float> ramp(roiwidth);
+    logc3_curve(colorspace, [&](auto curve) {
+        TraceSpan span("ocio apply", "ocio");
+        parallel_for(0, roiwidth, [&](int64_t i) {
+            const int x = roi.xbegin + i;
+            float relstop = (((float)x / width) * (signalsize - 1)) - 8;
+            float lin = pow(2, relstop) * midgray;
+            float log = outputlinear ? lin : curve.lin2log(lin);
+            ramp[i] = gray_value(log, transformProcessor);
+        });
+    });
+    
+    float* pixels = (float*)imageBuf.localpixels();
+    parallel_for(0, roi.height(), [&](int64_t j) {
+        const int y = roi.ybegin + j;
+        float* row = pixels + (size_t)j * roiwidth * channels;
+        bool lower = ((float)y / height) > 0.5;
+        for(int i=0; i<roiwidth; ++i) {
+            const int x = roi.xbegin + i;
+            float value = lower ? ramp[i] : stops[std::min<int>(signalsize - 1, x / stopwidth)].value;
+            for(int c=0; c<channels; c++) {
+                row[i * channels + c] = value;
+            }
+        }
+    });
+}
+
+static void render_stepchart_box(
+    ImageBuf& imageBuf,
+    const std::vector<StepStop>& stops
+) {
+    const int width = imageBuf.spec().full_width;
+    const int height = imageBuf.spec().full_height;
+    
+    float midlog = stops[stops.size() / 2].value;
+    float fillwidth = width * 0.4;
+    float fillheight = height * 0.2;
+    float fillcolor[3] = { midlog, midlog, midlog };
+    
+    float xbegin = (width - fillwidth) / 2.0;
+    float ybegin = (height - fillheight) / 2.0;
+
+    ROI fillroi(xbegin, width - xbegin, ybegin, height - ybegin);
+    if (clip_roi(imageBuf, fillroi)) {
+        ImageBufAlgo::fill(imageBuf, fillcolor, fillroi);
+    }
+}
+
+static void render_stepchart_labels(
+    ImageBuf& imageBuf,
+    const std::vector<StepStop>& stops,
+    float midgray,
+    int ei,
+    const std::string& transform
+) {
+    const int width = imageBuf.spec().full_width;
+    const int height = imageBuf.spec().full_height;
+    
+    std::string font = "Roboto.ttf";
+    float fontmedium = height * 0.04;
+    float fontlarge = height * 0.08;
+    float fontcolor[] = { 1, 1, 1, 1 };
+    
+    for (const StepStop& stop : stops) {
+        ImageBufAlgo::render_text(imageBuf,
+            stop.x,
+            height * 0.04,
+            std::to_string(stop.stop),
+            fontmedium,
+            font_path(font),
+            fontcolor,
+            ImageBufAlgo::TextAlignX::Center,
+            ImageBufAlgo::TextAlignY::Center
+        );
+    }
+    
+    ImageBufAlgo::render_text(imageBuf,
+        width / 2.0,
+        height / 2.0,
+        "LogC3 Ø:" +
+        float_to_str(midgray) +
+        " EI:" +
+        int_to_str(ei),
+        fontlarge,
+        font_path(font),
+        fontcolor,
+        ImageBufAlgo::TextAlignX::Center,
+        ImageBufAlgo::TextAlignY::Center
+    );
+    
+    if (transform.size()) {
+        ImageBufAlgo::render_text(
+            imageBuf,
+            width / 2.0,
+            height / 2.0 + fontlarge,
+            "Transform: " + transform,
+            fontmedium * 0.8,
+            font_path(font),
+            fontcolor,
+            ImageBufAlgo::TextAlignX::Center,
+            ImageBufAlgo::TextAlignY::Center
+        );
+    }
+}
+
+static void render_stepchart_codes(
+    ImageBuf& imageBuf,
+    const std::vector<StepStop>& stops,
+    const DataFormat& format
+) {
+    const int height = imageBuf.spec().full_height;
+    
+    std::string font = "Roboto.ttf";
+    float fontsmall = height * 0.025;
+    float fontmedium = height * 0.04;
+    float fontcolor[] = { 1, 1, 1, 1 };
+    
+    // code and signal
+    for (const StepStop& stop : stops) {
+        ImageBufAlgo::render_text(
+            imageBuf,
+            stop.x,
+            height * 0.04 + fontmedium,
+            code_to_str(stop.value, format),
+            fontsmall,
+            font_path(font),
+            fontcolor,
+            ImageBufAlgo::TextAlignX::Center,
+            ImageBufAlgo::TextAlignY::Center
+        );
+        ImageBufAlgo::render_text(
+            imageBuf,
+            stop.x,
+            height * 0.04 + fontmedium * 2,
+            signal_to_str(stop.value, format),
+            fontsmall,
+            font_path(font),
+            fontcolor,
+            ImageBufAlgo::TextAlignX::Center,
+            ImageBufAlgo::TextAlignY::Center
+        );
+    }
+}
+
+// patches
+static std::vector<Imath::Vec3<float>> patch_colors(
+    const std::vector<Patch>& patches,
+    LogC3Colorspace& colorspace,
+    bool outputlinear,
+    const ConstCPUProcessorRcPtr& transformProcessor,
+    float gain
+) {
+    // one slot per patch, same result for any thread count
+    std::vector<Imath::Vec3<float>> colors(patches.size());
+    logc3_curve(colorspace, [&](auto curve) {
+        parallel_for(0, (int64_t)patches.size(), [&](int64_t i) {
+            colors[i] = curve_patch_color(patches[i], colorspace, curve, outputlinear, transformProcessor, gain);
+        });
+    });
+    return colors;
+}
+
+static void render_patches(
+    ImageBuf& imageBuf,
+    const std::vector<Imath::Vec3<float>>& colors,
+    const PatchLayout& layout
+) {
+    const ImageSpec& spec = imageBuf.spec();
+    const int channels = imageBuf.nchannels();
+    const int fillchannels = std::min(3, channels);
+    const std::vector<PatchRect> rects = patch_rects(layout, spec.full_width);
+    
+    // bands between rect edges, each with the rects crossing it
+    std::vector<int> edges;
+    for (const PatchRect& rect : rects) {
+        edges.push_back(rect.roi.ybegin);
+        edges.push_back(rect.roi.yend);
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    std::vector<std::vector<int>> bands(edges.size());
+    for (size_t i = 0; i < rects.size(); i++) {
+        size_t begin = std::lower_bound(edges.begin(), edges.end(), rects[i].roi.ybegin) - edges.begin();
+        size_t end = std::lower_bound(edges.begin(), edges.end(), rects[i].roi.yend) - edges.begin();
+        for (size_t band = begin; band < end; band++) {
+            bands[band].push_back(i);
+        }
+    }
+    
+    // scanlines write their spans directly, data window in chart coordinates
+    float* pixels = (float*)imageBuf.localpixels();
+    parallel_for(0, spec.height, [&](int64_t j) {
+        const int y = spec.y + j;
+        size_t band = std::upper_bound(edges.begin(), edges.end(), y) - edges.begin();
+        if (band == 0) {
+            return;
+        }
+        float* row = pixels + (size_t)j * spec.width * channels;
+        for (int i : bands[band - 1]) {
+            const PatchRect& rect = rects[i];
+            const Imath::Vec3<float>& color = colors[rect.no];
+            const int x0 = std::max(rect.roi.xbegin, spec.x);
+            const int x1 = std::min(rect.roi.xend, spec.x + spec.width);
+            for (int x = x0; x < x1; x++) {
+                float* pixel = row + (size_t)(x - spec.x) * channels;
+                for (int c = 0; c < fillchannels; c++) {
+                    pixel[c] = color[c];
+                }
+            }
+        }
+    });
+}
+
+static void render_patch_labels(
+    ImageBuf& imageBuf,
+    const std::vector<Patch>& patches,
+    const PatchLayout& layout
+) {
+    const int width = imageBuf.spec().full_width;
+
+    const std::string fontfile = font_path("Roboto.ttf");
+    const float fontcolor[4] = {1,1,1,1};
+
+    for (int row = 0; row < layout.patchrows; ++row) {
+        for (int col = 0; col < layout.patchcols; ++col) {
+            const int no = patch_index(layout, row, col);
+            if (no < 0) {
+                continue;
+            }
+            const auto& patch = patches[no];
+            ROI roi = patch_roi(layout, row, col);
+            
+            const int cx = roi.xbegin + layout.patchwidth/2;
+            const int ty = roi.ybegin;
+
+            ImageBufAlgo::render_text(
+                imageBuf, cx, ty + (int)std::round(layout.patchheight * 0.50f),
+                patch.name, layout.sizecode, fontfile, fontcolor,
+                ImageBufAlgo::TextAlignX::Center,
+                ImageBufAlgo::TextAlignY::Center);
+        }
+    }
+
+    const int indices[2] = { layout.white_index, layout.black_index };
+    for (int i = 0; i < 2; ++i) {
+        const auto& patch = patches[ indices[i] ];
+        OIIO::ROI roi = reference_roi(layout, width, i);
+        
+        const int cx = layout.referencex + ((width - layout.referencex - layout.spacing) / 2);
+
+        ImageBufAlgo::render_text(
+            imageBuf, cx, roi.ybegin + (int)std::round(layout.referenceheight * 0.48f),
+            patch.name, layout.sizecode, fontfile, fontcolor,
+            ImageBufAlgo::TextAlignX::Center, ImageBufAlgo::TextAlignY::Center);
+    }
+}
+
+static void render_patch_codes(
+    ImageBuf& imageBuf,
+    const std::vector<Imath::Vec3<float>>& colors,
+    const PatchLayout& layout,
+    const DataFormat& format
+) {
+    const int width = imageBuf.spec().full_width;
+    
+    const std::string fontfile = font_path("Roboto.ttf");
+    const float fontcolor[4] = {1,1,1,1};
+    
+    for (int row = 0; row < layout.patchrows; ++row) {
+        for (int col = 0; col < layout.patchcols; ++col) {
+            const int no = patch_index(layout, row, col);
+            if (no < 0) {
+                continue;
+            }
+            ROI roi = patch_roi(layout, row, col);
+            ImageBufAlgo::render_text(
+                imageBuf, roi.xbegin + layout.patchwidth/2,
+                roi.ybegin + (int)std::round(layout.patchheight * 0.9f),
+                code_to_str(colors[no], format),
+                layout.sizelabel, fontfile, fontcolor,
+                ImageBufAlgo::TextAlignX::Center,
+                ImageBufAlgo::TextAlignY::Center);
+        }
+    }
+    
+    const int indices[2] = { layout.white_index, layout.black_index };
+    for (int i = 0; i < 2; ++i) {
+        ROI roi = reference_roi(layout, width, i);
+        ImageBufAlgo::render_text(
+            imageBuf, layout.referencex + ((width - layout.referencex - layout.spacing) / 2),
+            roi.ybegin + (int)std::round(layout.referenceheight * 0.55f),
+            code_to_str(colors[indices[i]], format),
+            layout.sizelabel, fontfile, fontcolor,
+            ImageBufAlgo::TextAlignX::Center, ImageBufAlgo::TextAlignY::Center);
+    }
+}
+
+static void render_labels(
+    OIIO::ImageBuf& imageBuf,
+    const std::string& dataformat,
+    const std::string& outputfilename,
+    const std::string& right_label,
+    const std::string& transform
+) {
+    const int width  = imageBuf.spec().full_width;
+    const int height = imageBuf.spec().full_height;
+
+    const float fontsmall = height * 0.025f;
+    const float xpad = width  * 0.02f;
+    const float ybase = height - height * 0.04f;
+    const float fontcolor[4] = {1,1,1,1};
+    const std::string fontfile = font_path("Roboto.ttf");
+
+    std::string left =
+        std::string("Logctool ") + datetime() + " " +
+        Filesystem::filename(outputfilename) + " (" +
+        dataformat + " " +
+        std::to_string(width) + "x" + std::to_string(height) + ")";
+
+    if (!transform.empty()) {
+        left += " - transform: " + transform;
+    }
+
+    OIIO::ImageBufAlgo::render_text(
+        imageBuf,
+        (int)std::round(xpad),
+        (int)std::round(ybase),
+        left,
+        fontsmall,
+        fontfile,
+        fontcolor,
+        OIIO::ImageBufAlgo::TextAlignX::Left,
+        OIIO::ImageBufAlgo::TextAlignY::Center
+    );
+
+    OIIO::ImageBufAlgo::render_text(
+        imageBuf,
+        (int)std::round(width - xpad),
+        (int)std::round(ybase),
+        right_label,
+        fontsmall,
+        fontfile,
+        fontcolor,
+        OIIO::ImageBufAlgo::TextAlignX::Right,
+        OIIO::ImageBufAlgo::TextAlignY::Center
+    );
+}
+
+
+// resources
+static std::string file_key(const std::string& filename)
+{
+    // parsed once per file version, edits are picked up by a warm process
+    return filename + "@" + std::to_string((long long)Filesystem::last_write_time(filename));
+}
+
+bool load_transforms(Resources& resources)
+{
+    std::string jsonfile = resources_path("logctool.json");
+    std::ifstream json(jsonfile);
+    if (!json.is_open()) {
+        print_error("could not open transforms file: ", jsonfile);
+        return false;
+    }
+    ptree pt;
+    read_json(jsonfile, pt);
+    for (const std::pair<const ptree::key_type, ptree>& item : pt) {
+        std::string name = item.first;
+        const ptree data = item.second;
+        LutTransform transform {
+            resources_path(data.get<std::string>("description", "")),
+            resources_path(data.get<std::string>("filename", "")),
+        };
+
+        if (!Filesystem::exists(transform.filename)) {
+            print_warning("'filename' does not exist for transform: ", transform.filename);
+            continue;
+        }
+        resources.transforms[name] = transform;
+    }
+    return true;
+}
+
+// bake, chain sampled once into a single 3d lut over the 0 - 1 log domain
+static ConstCPUProcessorRcPtr bake_processor(
+    const ConstConfigRcPtr& config,
+    const ConstCPUProcessorRcPtr& processor,
+    int size,
+    OptimizationFlags optimization
+) {
+    std::vector<float> values((size_t)size * size * size * 3);
+    parallel_for(0, size, [&](int64_t b) {
+        for (int g = 0; g < size; g++) {
+            for (int r = 0; r < size; r++) {
+                float* rgb = &values[(((size_t)b * size + g) * size + r) * 3];
+                rgb[0] = (float)r / (size - 1);
+                rgb[1] = (float)g / (size - 1);
+                rgb[2] = (float)b / (size - 1);
+                processor->applyRGB(rgb);
+            }
+        }
+    });
+    Lut3DTransformRcPtr lut = Lut3DTransform::Create(size);
+    lut->setInterpolation(INTERP_TETRAHEDRAL);
+    for (int b = 0; b < size; b++) {
+        for (int g = 0; g < size; g++) {
+            for (int r = 0; r < size; r++) {
+                const float* rgb = &values[(((size_t)b * size + g) * size + r) * 3];
+                lut->setValue(r, g, b, rgb[0], rgb[1], rgb[2]);
+            }
+        }
+    }
+    return config->getProcessor(lut)->getOptimizedCPUProcessor(BIT_DEPTH_F32, BIT_DEPTH_F32, optimization);
+}
+
+bool ocio_optimization(const std::string& name, OptimizationFlags& optimization)
+{
+    if (name == "default") {
+        optimization = OPTIMIZATION_DEFAULT;
+    }
+    else if (name == "none") {
+        optimization = OPTIMIZATION_NONE;
+    }
+    else if (name == "lossless") {
+        optimization = OPTIMIZATION_LOSSLESS;
+    }
+    else if (name == "verygood") {
+        optimization = OPTIMIZATION_VERY_GOOD;
+    }
+    else if (name == "good") {
+        optimization = OPTIMIZATION_GOOD;
+    }
+    else if (name == "draft") {
+        optimization = OPTIMIZATION_DRAFT;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+std::string transform_filename(const Resources& resources, const std::string& name)
+{
+    auto it = resources.transforms.find(name);
+    if (it != resources.transforms.end()) {
+        return it->second.filename;
+    }
+    // user lut file
+    if (Filesystem::is_regular(name)) {
+        return name;
+    }
+    return std::string();
+}
+
+ConstCPUProcessorRcPtr transform_processor(
+    Resources& resources,
+    const std::string& name,
+    int bakesize,
+    OptimizationFlags optimization
+) {
+    std::lock_guard<std::mutex> lock(resources.mutex);
+    std::vector<std::string> filenames;
+    std::string key;
+    for (const std::string& item : Strutil::splits(name, ",")) {
+        std::string filename = transform_filename(resources, item);
+        if (filename.empty()) {
+            return ConstCPUProcessorRcPtr();
+        }
+        filenames.push_back(filename);
+        key += file_key(filename) + ",";
+    }
+    if (filenames.empty()) {
+        return ConstCPUProcessorRcPtr();
+    }
+    if (bakesize > 0) {
+        key += int_to_str(bakesize);
+    }
+    if (optimization != OPTIMIZATION_DEFAULT) {
+        key += ":" + int_to_str((int)optimization);
+    }
+    auto it = resources.processors.find(key);
+    if (it != resources.processors.end()) {
+        return it->second;
+    }
+    // chain of transforms, applied in order
+    TraceSpan span("ocio processor", "ocio", name);
+    GroupTransformRcPtr group = GroupTransform::Create();
+    for (const std::string& filename : filenames) {
+        FileTransformRcPtr filetransform = FileTransform::Create();
+        filetransform->setSrc(filename.c_str());
+        filetransform->setInterpolation(INTERP_BEST);
+        group->appendTransform(filetransform);
+    }
+    ConstConfigRcPtr config = Config::CreateRaw();
+    ConstProcessorRcPtr processor = config->getProcessor(group);
+    ConstCPUProcessorRcPtr cpuprocessor = processor->getOptimizedCPUProcessor(BIT_DEPTH_F32, BIT_DEPTH_F32, optimization);
+    if (bakesize > 0) {
+        cpuprocessor = bake_processor(config, cpuprocessor, bakesize, optimization);
+    }
+    resources.processors[key] = cpuprocessor;
+    return cpuprocessor;
+}
+
+std::vector<Patch> patch_set(Resources& resources, const std::string& patchfile)
+{
+    std::lock_guard<std::mutex> lock(resources.mutex);
+    const std::string key = file_key(patchfile);
+    auto it = resources.patches.find(key);
+    if (it != resources.patches.end()) {
+        return it->second;
+    }
+    std::vector<Patch> patches = load_patches(patchfile);
+    if (patches.size()) {
+        resources.patches[key] = patches;
+    }
+    return patches;
+}
+
+static bool patch_sizes_valid(const PatchLayout& layout, int width, int height, std::string& error)
+{
+    if (layout.patchwidth <= 0 || layout.patchheight <= 0 || layout.referenceheight <= 0) {
+        error = "chart is too small for " + int_to_str(layout.patchcount) + " patches: "
+              + int_to_str(width) + "x" + int_to_str(height);
+        return false;
+    }
+    return true;
+}
+
+bool chart_patches(
+    const std::string& outputtype,
+    const std::string& patchfile,
+    int width,
+    int height,
+    Resources& resources,
+    PatchLayout& layout,
+    std::vector<Patch>& patches,
+    std::string& error
+) {
+    if (outputtype == "custom") {
+        if (patchfile.empty()) {
+            error = "custom output type needs a patch file";
+            return false;
+        }
+        patches = patch_set(resources, patchfile);
+        if (!patch_grid(patches, width, height, layout)) {
+            error = "could not load colorpatches: " + patchfile;
+            return false;
+        }
+        layout.patchfile = patchfile;
+        return patch_sizes_valid(layout, width, height, error);
+    }
+    if (!patch_layout(outputtype, width, height, layout)) {
+        error = "unknown output type: " + outputtype;
+        return false;
+    }
+    if (!patch_sizes_valid(layout, width, height, error)) {
+        return false;
+    }
+    if (patchfile.size()) {
+        layout.patchfile = patchfile;
+    }
+    patches = patch_set(resources, layout.patchfile);
+    if ((int)patches.size() != layout.patchcount) {
+        error = "could not match colorpatches " + int_to_str(layout.patchrows) + " rows x "
+              + int_to_str(layout.patchcols) + " colums = " + int_to_str(layout.patchcount)
+              + ", is now: " + int_to_str((int)patches.size());
+        return false;
+    }
+    return true;
+}
+
+
+// chart
+bool prepare_chart(Chart& chart, int width, int height, int channels, Resources& resources, std::string& error)
+{
+    chart.spec = ImageSpec(width, height, channels, TypeDesc::FLOAT);
+    if (chart.roi.defined()) {
+        ROI roi = roi_intersection(chart.roi, ROI(0, width, 0, height));
+        if (roi.width() <= 0 || roi.height() <= 0) {
+            error = "region is outside of image: " + int_to_str(width) + "x" + int_to_str(height);
+            return false;
+        }
+        chart.spec.x = roi.xbegin;
+        chart.spec.y = roi.ybegin;
+        chart.spec.width = roi.width();
+        chart.spec.height = roi.height();
+    }
+    
+    if (chart.outputtype == "stepchart") {
+        return true;
+    }
+    // patches
+    return chart_patches(chart.outputtype, chart.patchfile, width, height, resources,
+                         chart.layout, chart.patches, error);
+}
+
+void render_chart_values(Chart& chart)
+{
+    // every pixel is written, recycled buffers are not cleared
+    chart.masterData = pool_image(chart.masterBuf, chart.spec);
+    
+    const float gain = pow(2.0f, chart.exposure);
+    if (chart.outputtype == "stepchart") {
+        // signal
+        {
+            TraceSpan span("patch conversion", "render");
+            chart.stops = stepchart_stops(chart.spec.full_width,
+                                          chart.midgray * gain,
+                                          chart.colorspace,
+                                          chart.outputlinear,
+                                          chart.transformProcessor);
+        }
+        
+        // output image
+        TraceSpan span("rasterize", "render");
+        render_stepchart(chart.masterBuf,
+                         chart.stops,
+                         chart.colorspace,
+                         chart.midgray * gain,
+                         chart.outputlinear,
+                         chart.transformProcessor);
+        
+        if (!chart.outputnolabels) {
+            render_stepchart_box(chart.masterBuf, chart.stops);
+        }
+    }
+    else {
+        {
+            TraceSpan span("patch conversion", "render");
+            chart.colors = patch_colors(chart.patches,
+                                        chart.colorspace,
+                                        chart.outputlinear,
+                                        chart.transformProcessor,
+                                        gain);
+        }
+        
+        // background
+        TraceSpan span("rasterize", "render");
+        {
+            float log = background_value(chart.colorspace, chart.outputlinear, chart.transformProcessor);
+            ImageBufAlgo::fill(chart.masterBuf, {log, log, log});
+        }
+        
+        // render
+        render_patches(chart.masterBuf,
+                       chart.colors,
+                       chart.layout);
+    }
+}
+
+void render_chart_labels(const Chart& chart, ImageBuf& imageBuf)
+{
+    // format and exposure independent labels
+    TraceSpan span("text", "text");
+    if (chart.outputtype == "stepchart") {
+        LogC3Colorspace colorspace = chart.colorspace;
+        std::vector<StepStop> stops = chart.stops.size()
+            ? chart.stops
+            : stepchart_stops(chart.spec.full_width, chart.midgray, colorspace, chart.outputlinear, chart.transformProcessor);
+        render_stepchart_labels(imageBuf,
+                                stops,
+                                chart.midgray,
+                                chart.colorspace.ei,
+                                chart.transform);
+    } else {
+        render_patch_labels(imageBuf,
+                            chart.patches,
+                            chart.layout);
+    }
+}
+
+bool render_chart(Chart& chart, int width, int height, int channels, Resources& resources, std::string& error)
+{
+    if (!prepare_chart(chart, width, height, channels, resources, error)) {
+        return false;
+    }
+    render_chart_values(chart);
+    if (!chart.outputnolabels) {
+        render_chart_labels(chart, chart.masterBuf);
+    }
+    return true;
+}
+
+void render_overlay(const Chart& chart, ImageBuf& overlayBuf)
+{
+    // labels rendered once over transparent black, premultiplied
+    ImageSpec spec = chart.spec;
+    spec.nchannels = 4;
+    spec.default_channel_names();
+    spec.alpha_channel = 3;
+    overlayBuf.reset(spec);
+    render_chart_labels(chart, overlayBuf);
+}
+
+void composite_overlay(ImageBuf& imageBuf, const ImageBuf& overlayBuf)
+{
+    const ImageSpec& spec = imageBuf.spec();
+    const int channels = std::min(3, spec.nchannels);
+    const size_t npixels = (size_t)spec.width;
+    float* dst = (float*)imageBuf.localpixels();
+    const float* src = (const float*)overlayBuf.localpixels();
+    parallel_for(0, (int64_t)spec.height, [&](int64_t y) {
+        float* row = dst + (size_t)y * npixels * spec.nchannels;
+        const float* overlay = src + (size_t)y * npixels * 4;
+        for (size_t x = 0; x < npixels; x++) {
+            const float* o = overlay + x * 4;
+            if (o[3] <= 0.0f) {
+                continue;
+            }
+            for (int c = 0; c < channels; c++) {
+                row[x * spec.nchannels + c] = o[c] + row[x * spec.nchannels + c] * (1.0f - o[3]);
+            }
+        }
+    });
+}
+
+bool render_output(
+    ImageBuf& imageBuf,
+    const Chart& chart,
+    const DataFormat& format,
+    const std::string& filename
+) {
+    {
+        TraceSpan span("quantize", "render", format.name);
+        if (!quantize_image(imageBuf, chart.masterBuf, format, chart.optimization)) {
+            return false;
+        }
+    }
+    if (!chart.outputnolabels) {
+        TraceSpan span("text", "text", format.name);
+        if (chart.outputtype == "stepchart") {
+            render_stepchart_codes(imageBuf, chart.stops, format);
+        } else {
+            render_patch_codes(imageBuf, chart.colors, chart.layout, format);
+        }
+        std::string label = chart.outputtype == "stepchart" ? "stepchart" : "colorchecker";
+        if (chart.exposure != 0.0f) {
+            label += std::string(" ") + (chart.exposure > 0.0f ? "+" : "") + float_to_str(chart.exposure) + " stops";
+        }
+        render_labels(
+                    imageBuf,
+                    format.name,
+                    filename,
+                    label,
+                    chart.transform);
+    }
+    return true;
+}
+
+// cube lut
+static std::vector<Imath::Vec4<float>> lut_colors(
+    const std::string& type,
+    LogC3Colorspace& colorspace,
+    float midgray,
+    const ConstCPUProcessorRcPtr& transformProcessor
+) {
+    // table, luma threshold in transform output and hsv
+    std::vector<Imath::Vec4<float>> colors;
+    if (type == "falsecolor") {
+        colors = {
+            // purple - black clipping
+            Imath::Vec4<float>(-6, 250.0f, 0.6f, 0.6f),
+            // blue
+            Imath::Vec4<float>(-4, 200, 0.6f, 0.6f),
+            // gray
+            Imath::Vec4<float>(0 , 90.0, 0.1f, 0.5f),
+            // pink
+            Imath::Vec4<float>(1 , 330.0f, 0.8f, 0.9f),
+            // yellow
+            Imath::Vec4<float>(2.5 , 50, 0.8f, 0.9f),
+            // red - white clipping
+            Imath::Vec4<float>(6 , 5.0f, 0.6f, 1.0f),
+        };
+    }
+    else if (type == "stops") {
+        colors = {
+            // blacks
+            Imath::Vec4<float>(-8, 90.0f, 0.0f, 0.0f),
+            Imath::Vec4<float>(-7, 90.0f, 0.0f, 0.0f),
+            // purple - toe
+            Imath::Vec4<float>(-6, 270.0f, 0.6f, 0.6f),
+            Imath::Vec4<float>(-5, 270.0f, 0.4f, 0.8f),
+            // cyan
+            Imath::Vec4<float>(-4, 180.0f, 0.6f, 0.6f),
+            Imath::Vec4<float>(-3, 180.0f, 0.4f, 0.8f),
+            // green
+            Imath::Vec4<float>(-2, 90.0f, 0.6f, 0.6f),
+            Imath::Vec4<float>(-1, 90.0f, 0.4f, 0.8f),
+            // gray
+            Imath::Vec4<float>(0 , 90.0, 0.1f, 0.5f),
+            // yellow
+            Imath::Vec4<float>(1 , 60.0f, 0.8f, 0.9f),
+            Imath::Vec4<float>(2 , 60.0f, 0.6f, 1.0f),
+            // orange
+            Imath::Vec4<float>(3 , 40.0f, 0.8f, 0.9f),
+            Imath::Vec4<float>(4 , 40.0f, 0.6f, 1.0f),
+            // cerise
+            Imath::Vec4<float>(5 , 330.0f, 0.8f, 0.9f),
+            Imath::Vec4<float>(6 , 330.0f, 0.6f, 1.0f),
+            // pink
+            Imath::Vec4<float>(7 , 90.0f, 0.0f, 0.9f),
+            Imath::Vec4<float>(8 , 90.0f, 0.0f, 1.0f),
+        };
+    }
+    else {
+        return colors;
+    }
+    
+    for (Imath::Vec4<float>& color : colors) {
+        float lin = pow(2, color[0]+0.5f) * midgray;
+        float log = std::min<float>(colorspace.lin2log(lin), 1.0f);
+        color[0] = gray_value(log, transformProcessor);
+    }
+    return colors;
+}
+
+static void lut_color(const std::vector<Imath::Vec4<float>>& colors, float y, float* values)
+{
+    for (size_t index = 0; index < colors.size(); index++) {
+        const Imath::Vec4<float>& color = colors[index];
+        if (y <= color[0] || index == colors.size() - 1) {
+            Imath::Vec3<float> rgb = hsv_to_rgb(
+                Imath::Vec3<float>(color[1], color[2], color[3])
+            );
+            values[0] = pow_gamma(rgb[0], 2.2f);
+            values[1] = pow_gamma(rgb[1], 2.2f);
+            values[2] = pow_gamma(rgb[2], 2.2f);
+            break;
+        }
+    }
+}
+
+std::vector<float> cube_lut_values(
+    const std::string& type,
+    int size,
+    LogC3Colorspace& colorspace,
+    float midgray,
+    const ConstCPUProcessorRcPtr& transformProcessor
+) {
+    std::vector<float> values;
+    std::vector<Imath::Vec4<float>> colors = lut_colors(type, colorspace, midgray, transformProcessor);
+    if (colors.empty()) {
+        return values;
+    }
+    
+    const int nsize = size * size * size;
+    values.resize(nsize * 3);
+    parallel_for(0, (int64_t)nsize, [&](int64_t i) {
+        float r = std::max(0.0f, std::min(1.0f, static_cast<float>(i % size) / (size - 1)));
+        float g = std::max(0.0f, std::min(1.0f, static_cast<float>((i / size) % size) / (size - 1)));
+        float b = std::max(0.0f, std::min(1.0f, static_cast<float>((i / (size * size)) % size) / (size - 1)));
+        float y = 0.2126 * r + 0.7152 * g + 0.0722 * b; // use Rec709 coeff
+        lut_color(colors, y, &values[i * 3]);
+    });
+    return values;
+}
+
+// luma lut
+std::vector<float> luma_lut_values(
+    const std::string& type,
+    int size,
+    LogC3Colorspace& colorspace,
+    float midgray,
+    const ConstCPUProcessorRcPtr& transformProcessor
+) {
+    std::vector<float> values;
+    std::vector<Imath::Vec4<float>> colors = lut_colors(type, colorspace, midgray, transformProcessor);
+    if (colors.empty()) {
+        return values;
+    }
+    values.resize(size * 3);
+    for (int i = 0; i < size; i++) {
+        lut_color(colors, static_cast<float>(i) / (size - 1), &values[i * 3]);
+    }
+    return values;
+}
+
+// inverse cube lut
+static float det3(const float m[3][3])
+{
+    return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+         - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+         + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+static bool solve3(const float m[3][3], const float b[3], float x[3])
+{
+    // cramer's rule, singular where the forward transform clips
+    const float det = det3(m);
+    if (std::abs(det) < 1e-12f) {
+        return false;
+    }
+    for (int c = 0; c < 3; c++) {
+        float mc[3][3];
+        for (int i = 0; i < 3; i++) {
+            for (int k = 0; k < 3; k++) {
+                mc[i][k] = k == c ? b[i] : m[i][k];
+            }
+        }
+        x[c] = det3(mc) / det;
+    }
+    return true;
+}
+
+std::vector<float> inverse_lut_values(
+    int size,
+    const ConstCPUProcessorRcPtr& transformProcessor,
+    InverseError& error
+) {
+    // neutral axis response per channel, seeds by bisection
+    const int naxis = 4096;
+    std::vector<float> axis(naxis * 3);
+    for (int i = 0; i < naxis; i++) {
+        axis[i * 3] = axis[i * 3 + 1] = axis[i * 3 + 2] = (float)i / (naxis - 1);
+    }
+    PackedImageDesc axisdesc(axis.data(), naxis, 1, 3);
+    transformProcessor->apply(axisdesc);
+    auto seed = [&](int c, float y) -> float {
+        int lo = 0;
+        int hi = naxis - 1;
+        if (y <= axis[c]) {
+            return 0.0f;
+        }
+        if (y >= axis[hi * 3 + c]) {
+            return 1.0f;
+        }
+        while (hi - lo > 1) {
+            const int mid = (lo + hi) / 2;
+            if (axis[mid * 3 + c] < y) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        const float y0 = axis[lo * 3 + c];
+        const float y1 = axis[hi * 3 + c];
+        const float t = y1 > y0 ? (y - y0) / (y1 - y0) : 0.0f;
+        return (lo + t) / (naxis - 1);
+    };
+    
+    const int nsize = size * size * size;
+    std::vector<float> values(nsize * 3);
+    std::vector<float> errors(nsize);
+    const float h = 1e-3f;
+    const float tolerance = 1e-6f;
+    const int maxiter = 16;
+    
+    // one row of red per task, newton on the whole row with one apply per iteration
+    parallel_for(0, (int64_t)size * size, [&](int64_t row) {
+        const int g = row % size;
+        const int b = row / size;
+        std::vector<float> target(size * 3);
+        std::vector<float> x(size * 3);
+        std::vector<float> rowerror(size);
+        std::vector<float> eval(size * 4 * 3);
+        for (int r = 0; r < size; r++) {
+            target[r * 3] = (float)r / (size - 1);
+            target[r * 3 + 1] = (float)g / (size - 1);
+            target[r * 3 + 2] = (float)b / (size - 1);
+            for (int c = 0; c < 3; c++) {
+                x[r * 3 + c] = seed(c, target[r * 3 + c]);
+            }
+        }
+        auto newton = [&]() {
+            for (int iter = 0; iter <= maxiter; iter++) {
+                // point and an offset per channel
+                for (int r = 0; r < size; r++) {
+                    for (int k = 0; k < 4; k++) {
+                        float* p = &eval[(r * 4 + k) * 3];
+                        for (int c = 0; c < 3; c++) {
+                            p[c] = x[r * 3 + c];
+                        }
+                        if (k > 0) {
+                            p[k - 1] += p[k - 1] + h <= 1.0f ? h : -h;
+                        }
+                    }
+                }
+                PackedImageDesc desc(eval.data(), size * 4, 1, 3);
+                transformProcessor->apply(desc);
+                
+                bool converged = true;
+                for (int r = 0; r < size; r++) {
+                    const float* f = &eval[r * 4 * 3];
+                    float residual[3];
+                    rowerror[r] = 0.0f;
+                    for (int c = 0; c < 3; c++) {
+                        residual[c] = target[r * 3 + c] - f[c];
+                        rowerror[r] = std::max(rowerror[r], std::abs(residual[c]));
+                    }
+                    if (rowerror[r] <= tolerance || iter == maxiter) {
+                        continue;
+                    }
+                    converged = false;
+                    float jacobian[3][3];
+                    for (int k = 0; k < 3; k++) {
+                        const float step = x[r * 3 + k] + h <= 1.0f ? h : -h;
+                        const float* fk = &eval[(r * 4 + k + 1) * 3];
+                        for (int i = 0; i < 3; i++) {
+                            jacobian[i][k] = (fk[i] - f[i]) / step;
+                        }
+                    }
+                    float dx[3];
+                    if (!solve3(jacobian, residual, dx)) {
+                        continue;
+                    }
+                    for (int c = 0; c < 3; c++) {
+                        const float step = std::max(-0.25f, std::min(0.25f, dx[c]));
+                        x[r * 3 + c] = std::max(0.0f, std::min(1.0f, x[r * 3 + c] + step));
+                    }
+                }
+                if (converged) {
+                    break;
+                }
+            }
+        };
+        newton();
+        
+        // unconverged points restart from a converged neighbor, best result is kept
+        std::vector<float> best = x;
+        std::vector<float> besterror = rowerror;
+        bool retry = false;
+        for (int r = 0; r < size; r++) {
+            if (besterror[r] <= tolerance) {
+                continue;
+            }
+            const int n = r > 0 && besterror[r - 1] <= tolerance ? r - 1
+                        : r + 1 < size && besterror[r + 1] <= tolerance ? r + 1 : -1;
+            if (n >= 0) {
+                std::copy(&best[n * 3], &best[n * 3 + 3], &x[r * 3]);
+                retry = true;
+            }
+        }
+        if (retry) {
+            newton();
+            for (int r = 0; r < size; r++) {
+                if (rowerror[r] < besterror[r]) {
+                    std::copy(&x[r * 3], &x[r * 3 + 3], &best[r * 3]);
+                    besterror[r] = rowerror[r];
+                }
+            }
+        }
+        const size_t offset = (size_t)row * size;
+        std::copy(best.begin(), best.end(), &values[offset * 3]);
+        std::copy(besterror.begin(), besterror.end(), &errors[offset]);
+    });
+    
+    // round trip, forward of the inverse against the lattice
+    error = InverseError();
+    double sum = 0.0;
+    for (float e : errors) {
+        error.max = std::max(error.max, e);
+        sum += e;
+        if (e > 1e-3f) {
+            error.unreachable++;
+        }
+    }
+    error.mean = nsize ? (float)(sum / nsize) : 0.0f;
+    return values;
+}
+
+bool write_cube_lut(
+    const std::string& filename,
+    const std::string& type,
+    const std::vector<float>& values,
+    int size,
+    int ei,
+    const std::string& transform,
+    const std::string& hash
+) {
+    std::ofstream outputFile(filename);
+    if (!outputFile) {
+        return false;
+    }
+    if (type == "inverse") {
+    outputFile << "# LogCTool Inverse LUT" << std::endl;
+    outputFile << "#   Input: Transform: " << transform << std::endl;
+    outputFile << "#        : floating point data (range 0.0 - 1.0)" << std::endl;
+    outputFile << "#  Output: LogC3 EI: " << ei << std::endl;
+    outputFile << "#        : floating point data (range 0.0 - 1.0)" << std::endl;
+    } else {
+    const bool falsecolor = type == "falsecolor";
+    outputFile << (falsecolor ? "# LogCTool False color LUT" : "# LogCTool Stops LUT") << std::endl;
+    outputFile << "#   Input: LogC3 EI: " << ei << std::endl;
+    if (transform.size()) {
+    outputFile << "#        : Transform: " << transform << std::endl;
+    }
+    outputFile << "#        : floating point data (range 0.0 - 1.0)" << std::endl;
+    outputFile << (falsecolor ? "#  Output: False color luminance colors" : "#  Output: Stops luminance colors") << std::endl;
+    outputFile << "#        : floating point data (range 0.0 - 1.0)" << std::endl;
+    }
+    if (hash.size()) {
+    outputFile << "#    Hash: " << hash << std::endl;
+    }
+    outputFile << std::endl;
+    outputFile << "LUT_3D_SIZE " << size << std::endl;
+    outputFile << "DOMAIN_MIN 0.0 0.0 0.0" << std::endl;
+    outputFile << "DOMAIN_MAX 1.0 1.0 1.0" << std::endl;
+    outputFile << std::endl;
+    
+    const size_t nsize = values.size() / 3;
+    for (size_t i = 0; i < nsize; ++i) {
+        outputFile << values[i * 3] << " "
+                   << values[i * 3 + 1] << " "
+                   << values[i * 3 + 2] << std::endl;
+    }
+    return true;
+}
+
+bool write_luma_lut(
+    const std::string& filename,
+    const std::string& type,
+    const std::vector<float>& values,
+    int size,
+    int ei,
+    const std::string& transform,
+    const std::string& hash
+) {
+    std::ofstream outputFile(filename);
+    if (!outputFile) {
+        return false;
+    }
+    const bool falsecolor = type == "falsecolor";
+    const size_t nsize = values.size() / 3;
+    if (Strutil::lower(Filesystem::extension(filename)) == ".clf") {
+    // clf, luma matrix into a 1d lut
+    outputFile << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << std::endl;
+    outputFile << "<ProcessList id=\"logctool_" << type << "\" compCLFversion=\"3\">" << std::endl;
+    outputFile << "    <Description>" << (falsecolor ? "LogCTool False color LUT" : "LogCTool Stops LUT") << "</Description>" << std::endl;
+    if (hash.size()) {
+    outputFile << "    <Description>Hash: " << hash << "</Description>" << std::endl;
+    }
+    outputFile << "    <InputDescriptor>LogC3 EI: " << ei;
+    if (transform.size()) {
+    outputFile << ", Transform: " << transform;
+    }
+    outputFile << "</InputDescriptor>" << std::endl;
+    outputFile << "    <OutputDescriptor>" << (falsecolor ? "False color luminance colors" : "Stops luminance colors") << "</OutputDescriptor>" << std::endl;
+    outputFile << "    <Matrix inBitDepth=\"32f\" outBitDepth=\"32f\">" << std::endl;
+    outputFile << "        <Description>Rec709 luma</Description>" << std::endl;
+    outputFile << "        <Array dim=\"3 3\">" << std::endl;
+    for (int i = 0; i < 3; i++) {
+    outputFile << "            0.2126 0.7152 0.0722" << std::endl;
+    }
+    outputFile << "        </Array>" << std::endl;
+    outputFile << "    </Matrix>" << std::endl;
+    outputFile << "    <LUT1D inBitDepth=\"32f\" outBitDepth=\"32f\">" << std::endl;
+    outputFile << "        <Array dim=\"" << size << " 3\">" << std::endl;
+    for (size_t i = 0; i < nsize; ++i) {
+        outputFile << "            "
+                   << values[i * 3] << " "
+                   << values[i * 3 + 1] << " "
+                   << values[i * 3 + 2] << std::endl;
+    }
+    outputFile << "        </Array>" << std::endl;
+    outputFile << "    </LUT1D>" << std::endl;
+    outputFile << "</ProcessList>" << std::endl;
+    return true;
+    }
+    // cube, input is luma
+    outputFile << (falsecolor ? "# LogCTool False color LUT" : "# LogCTool Stops LUT") << std::endl;
+    outputFile << "#   Input: Rec709 luma of LogC3 EI: " << ei << std::endl;
+    if (transform.size()) {
+    outputFile << "#        : Transform: " << transform << std::endl;
+    }
+    outputFile << "#        : floating point data (range 0.0 - 1.0)" << std::endl;
+    outputFile << (falsecolor ? "#  Output: False color luminance colors" : "#  Output: Stops luminance colors") << std::endl;
+    outputFile << "#        : floating point data (range 0.0 - 1.0)" << std::endl;
+    if (hash.size()) {
+    outputFile << "#    Hash: " << hash << std::endl;
+    }
+    outputFile << std::endl;
+    outputFile << "LUT_1D_SIZE " << size << std::endl;
+    outputFile << "DOMAIN_MIN 0.0 0.0 0.0" << std::endl;
+    outputFile << "DOMAIN_MAX 1.0 1.0 1.0" << std::endl;
+    outputFile << std::endl;
+    for (size_t i = 0; i < nsize; ++i) {
+        outputFile << values[i * 3] << " "
+                   << values[i * 3 + 1] << " "
+                   << values[i * 3 + 2] << std::endl;
+    }
+    return true;
+}
+
+// cache
+std::string content_hash(const std::vector<std::string>& values, const std::vector<std::string>& files)
+{
+    SHA1 sha;
+    for (const std::string& value : values) {
+        sha.append(value.c_str(), value.size() + 1); // null separated
+    }
+    for (const std::string& file : files) {
+        std::ifstream inputFile(file, std::ios::binary);
+        if (!inputFile) {
+            const std::string tag = "missing:" + file;
+            sha.append(tag.c_str(), tag.size() + 1);
+            continue;
+        }
+        std::vector<char> buffer(1 << 16);
+        while (inputFile.read(buffer.data(), buffer.size()) || inputFile.gcount()) {
+            sha.append(buffer.data(), inputFile.gcount());
+        }
+    }
+    return sha.digest();
+}
+
+// render api
+static Resources& default_resources()
+{
+    static Resources resources;
+    static std::once_flag once;
+    std::call_once(once, [&]() {
+        load_transforms(resources);
+    });
+    return resources;
+}
+
+void setResourcesPath(const std::string& path)
+{
+    resources_root = path;
+}
+
+void setThreads(int threads)
+{
+    // oiio pool drives parallel_for, imagebufalgo and codecs, 0 is all cores
+    OIIO::attribute("threads", threads);
+    OIIO::attribute("exr_threads", threads);
+}
+
+static bool render_options(
+    const RenderOptions& options,
+    Chart& chart,
+    DataFormat& format,
+    std::string& error
+) {
+    if (!logc3_colorspace(options.ei, chart.colorspace)) {
+        error = "unknown ei: " + int_to_str(options.ei);
+        return false;
+    }
+    if (!data_format(options.dataformat, format)) {
+        error = "unknown data format: " + options.dataformat;
+        return false;
+    }
+    if (!ocio_optimization(options.optimization, chart.optimization)) {
+        error = "unknown optimization: " + options.optimization;
+        return false;
+    }
+    if (options.transform.size()) {
+        if (options.transformbake == 1 || options.transformbake < 0) {
+            error = "transform bake size must be at least 2: " + int_to_str(options.transformbake);
+            return false;
+        }
+        chart.transformProcessor = transform_processor(default_resources(), options.transform, options.transformbake, chart.optimization);
+        if (!chart.transformProcessor) {
+            error = "unknown transform: " + options.transform;
+            return false;
+        }
+    }
+    chart.midgray = options.midgray;
+    chart.transform = options.transform;
+    chart.patchfile = options.patchfile;
+    chart.outputlinear = options.outputlinear;
+    chart.outputnolabels = options.outputnolabels;
+    return true;
+}
+
+static ImageSpec render_spec(const RenderOptions& options, const DataFormat& format)
+{
+    ImageSpec spec (options.width, options.height, options.channels, format.typedesc);
+    if (options.roi.defined()) {
+        spec.x = options.roi.xbegin;
+        spec.y = options.roi.ybegin;
+        spec.width = options.roi.width();
+        spec.height = options.roi.height();
+    }
+    if (format.is10bit) {
+        spec.attribute("oiio:BitsPerSample", 10);
+    }
+    return spec;
+}
+
+size_t imageBytes(const RenderOptions& options)
+{
+    DataFormat format;
+    if (!data_format(options.dataformat, format)) {
+        return 0;
+    }
+    return render_spec(options, format).image_bytes();
+}
+
+static bool render_image(
+    const RenderOptions& options,
+    const std::string& type,
+    ImageBuf& imageBuf,
+    std::string& error
+) {
+    Chart chart;
+    DataFormat format;
+    chart.outputtype = type;
+    chart.roi = options.roi;
+    if (!render_options(options, chart, format, error)) {
+        return false;
+    }
+    if (!render_chart(chart, options.width, options.height, options.channels, default_resources(), error)) {
+        return false;
+    }
+    if (!render_output(imageBuf, chart, format, options.label)) {
+        error = "could not quantize image: " + imageBuf.geterror();
+        return false;
+    }
+    return true;
+}
+
+static bool render_data(
+    const RenderOptions& options,
+    const std::string& type,
+    void* data,
+    size_t size,
+    std::string& error
+) {
+    DataFormat format;
+    if (!data_format(options.dataformat, format)) {
+        error = "unknown data format: " + options.dataformat;
+        return false;
+    }
+    ImageSpec spec = render_spec(options, format);
+    if (!data || size < spec.image_bytes()) {
+        error = "buffer is smaller than image, expected bytes: " + std::to_string(spec.image_bytes());
+        return false;
+    }
+    // caller-owned pixels, quantized and labeled in place
+    ImageBuf imageBuf(spec, data);
+    return render_image(options, type, imageBuf, error);
+}
+
+bool renderStepchart(const RenderOptions& options, ImageBuf& imageBuf, std::string& error)
+{
+    return render_image(options, "stepchart", imageBuf, error);
+}
+
+bool renderStepchart(const RenderOptions& options, void* data, size_t size, std::string& error)
+{
+    return render_data(options, "stepchart", data, size, error);
+}
+
+bool renderPatchChart(
+    const RenderOptions& options,
+    const std::string& type,
+    ImageBuf& imageBuf,
+    std::string& error
+) {
+    if (type == "stepchart") {
+        error = "unknown patch chart type: " + type;
+        return false;
+    }
+    return render_image(options, type, imageBuf, error);
+}
+
+bool renderPatchChart(
+    const RenderOptions& options,
+    const std::string& type,
+    void* data,
+    size_t size,
+    std::string& error
+) {
+    if (type == "stepchart") {
+        error = "unknown patch chart type: " + type;
+        return false;
+    }
+    return render_data(options, type, data, size, error);
+}
+
+bool generateCubeLut(
+    const RenderOptions& options,
+    const std::string& type,
+    int size,
+    float* data,
+    std::string& error
+) {
+    Chart chart;
+    DataFormat format;
+    if (!render_options(options, chart, format, error)) {
+        return false;
+    }
+    if (size < 2 || !data) {
+        error = "invalid cube size: " + int_to_str(size);
+        return false;
+    }
+    std::vector<float> values =
+        cube_lut_values(type, size, chart.colorspace, chart.midgray, chart.transformProcessor);
+    if (values.empty()) {
+        error = "unknown cube type: " + type;
+        return false;
+    }
+    std::copy(values.begin(), values.end(), data);
+    return true;
+}
+
+}
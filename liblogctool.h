@@ -0,0 +1,66 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2022 - present Mikael Sundell.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// openimageio
+#include <OpenImageIO/imagebuf.h>
+
+// bump when rendering changes, part of the cache hash
+#define LOGCTOOL_VERSION "1.1"
+
+namespace logctool {
+
+// render api
+struct RenderOptions
+{
+    int ei = 800;
+    int width = 1024;
+    int height = 512;
+    int channels = 3;
+    float midgray = 0.18f;
+    std::string dataformat = "float";
+    std::string transform; // comma separated chain
+    int transformbake = 0; // 3d lut size of the baked chain, 0 applies each transform
+    std::string optimization = "default"; // ocio optimization of transform and quantize processors
+    bool outputlinear = false;
+    bool outputnolabels = false;
+    std::string patchfile; // patch set for classic, digitalsg or custom
+    std::string label; // footer name, no file is written
+    OIIO::ROI roi; // region in chart coordinates, undefined for all
+};
+
+void setResourcesPath(const std::string& path);
+void setThreads(int threads);
+size_t imageBytes(const RenderOptions& options);
+
+bool renderStepchart(const RenderOptions& options, OIIO::ImageBuf& imageBuf, std::string& error);
+bool renderStepchart(const RenderOptions& options, void* data, size_t size, std::string& error);
+
+// type is classic, digitalsg or custom
+bool renderPatchChart(
+    const RenderOptions& options,
+    const std::string& type,
+    OIIO::ImageBuf& imageBuf,
+    std::string& error);
+bool renderPatchChart(
+    const RenderOptions& options,
+    const std::string& type,
+    void* data,
+    size_t size,
+    std::string& error);
+
+// data holds size^3 rgb floats, red fastest
+bool generateCubeLut(
+    const RenderOptions& options,
+    const std::string& type,
+    int size,
+    float* data,
+    std::string& error);
+
+}
@@ -0,0 +1,541 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2022 - present Mikael Sundell.
+//
+
+#pragma once
+
+// internal api of the library, shared with the cli and tests, not installed
+#include "liblogctool.h"
+
+#include <iostream>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// imath
+#include <Imath/ImathMatrix.h>
+#include <Imath/ImathVec.h>
+
+// openimageio
+#include <OpenImageIO/typedesc.h>
+#include <OpenImageIO/imagebuf.h>
+
+// opencolorio
+#include <OpenColorIO/OpenColorIO.h>
+
+// boost
+#include <boost/property_tree/ptree.hpp>
+
+namespace logctool {
+
+// prints
+extern std::mutex print_mutex;
+extern std::ostream* info_stream;
+
+template <typename T>
+inline void
+print_info(std::string param, const T& value = T()) {
+    std::lock_guard<std::mutex> lock(print_mutex);
+    *info_stream << "info: " << param << value << std::endl;
+}
+
+inline void
+print_info(std::string param) {
+    print_info<std::string>(param);
+}
+
+template <typename T>
+inline void
+print_warning(std::string param, const T& value = T()) {
+    std::lock_guard<std::mutex> lock(print_mutex);
+    *info_stream << "warning: " << param << value << std::endl;
+}
+
+inline void
+print_warning(std::string param) {
+    print_warning<std::string>(param);
+}
+
+template <typename T>
+inline void
+print_error(std::string param, const T& value = T()) {
+    std::lock_guard<std::mutex> lock(print_mutex);
+    std::cerr << "error: " << param << value << std::endl;
+}
+
+inline void
+print_error(std::string param) {
+    print_error<std::string>(param);
+}
+
+// utils
+std::string datetime();
+Imath::Vec3<float> hsv_to_rgb(const Imath::Vec3<float>& hsv);
+float pow_gamma(float value, float gamma);
+int _10bit_to_int(int value);
+std::string float_to_str(float value, int precision = 2);
+std::string percent_to_str(float value);
+std::string int_to_str(int value);
+std::string _10bit_to_str(int value);
+
+// paths, fonts and resources default to next to the program
+std::string program_path(const std::string& path);
+std::string font_path(const std::string& font);
+std::string resources_path(const std::string& resource);
+
+// color
+Imath::Vec3<float> mult_matrix(const Imath::Vec3<float>& src, const Imath::Matrix33<float>& matrix);
+Imath::Vec3<float> lab_to_d50(const Imath::Vec3<float>& src);
+Imath::Vec3<float> d50_to_d65(const Imath::Vec3<float>& src);
+Imath::Vec3<float> d65_to_d50(const Imath::Vec3<float>& src);
+Imath::Vec3<float> d50_to_lab(const Imath::Vec3<float>& src);
+float delta_e(const Imath::Vec3<float>& lab1, const Imath::Vec3<float>& lab2);
+
+// logc3 curve
+inline float logc3_lin2log(float lin, float cut, float a, float b, float c, float d, float e, float f)
+{
+    return ((lin > cut) ? c * log10(a * lin + b) + d : e * lin + f);
+}
+
+inline float logc3_log2lin(float log, float cut, float a, float b, float c, float d, float e, float f)
+{
+    return ((log > e * cut + f) ? (pow(10, (log - d) / c) - b) / a : (log - f) / e);
+}
+
+// logc3 colorspace
+struct LogC3Colorspace
+{
+    int ei;
+    float cut;
+    float a;
+    float b;
+    float c;
+    float d;
+    float e;
+    float f;
+    bool operator==(const LogC3Colorspace& other) const
+    {
+        return ei == other.ei && cut == other.cut && a == other.a && b == other.b
+            && c == other.c && d == other.d && e == other.e && f == other.f;
+    }
+    float lin2log(float lin) const
+    {
+        return logc3_lin2log(lin, cut, a, b, c, d, e, f);
+    }
+    float log2lin(float log) const
+    {
+        return logc3_log2lin(log, cut, a, b, c, d, e, f);
+    }
+    Imath::Vec3<float> xyz_from_awg3(Imath::Vec3<float> color) const
+    {
+        Imath::Matrix33<float> matrix(
+            1.789066f, -0.482534f, -0.200076f,
+            -0.639849f, 1.396400f, 0.194432f,
+            -0.041532f, 0.082335f, 0.878868f);
+        return mult_matrix(color, matrix);
+    }
+    Imath::Vec3<float> awg3_from_xyz(Imath::Vec3<float> color) const
+    {
+        Imath::Matrix33<float> matrix(
+            0.638008f, 0.214704f, 0.097744f,
+            0.291954f, 0.823841f, -0.115795f,
+            0.002798f, -0.067034f, 1.153294f);
+        return mult_matrix(color, matrix);
+    }
+};
+
+// logc curve families, the formula and colorspace of a curve and the ei values of its table
+template <int... EI>
+struct LogCTable {};
+
+struct LogC3Family
+{
+    using Colorspace = LogC3Colorspace;
+    using Table = LogCTable<160, 200, 250, 320, 400, 500, 640, 800, 1000, 1280, 1600>;
+    static float lin2log(float lin, float cut, float a, float b, float c, float d, float e, float f)
+    {
+        return logc3_lin2log(lin, cut, a, b, c, d, e, f);
+    }
+    static float log2lin(float log, float cut, float a, float b, float c, float d, float e, float f)
+    {
+        return logc3_log2lin(log, cut, a, b, c, d, e, f);
+    }
+};
+
+// logc curve policy per family and ei, constants fold into the instantiated kernels
+template <typename Family, int EI>
+struct LogCCurve;
+
+template <int EI>
+using LogC3Curve = LogCCurve<LogC3Family, EI>;
+
+#define LOGCTOOL_LOGC_CURVE(FAMILY, EI, CUT, A, B, C, D, E, F) \
+template <> \
+struct LogCCurve<FAMILY, EI> \
+{ \
+    static constexpr int ei = EI; \
+    static float lin2log(float lin) { return FAMILY::lin2log(lin, CUT, A, B, C, D, E, F); } \
+    static float log2lin(float log) { return FAMILY::log2lin(log, CUT, A, B, C, D, E, F); } \
+    static FAMILY::Colorspace colorspace() { return FAMILY::Colorspace { EI, CUT, A, B, C, D, E, F }; } \
+};
+
+//                                ei    cut        a          b          c          d          e          f
+LOGCTOOL_LOGC_CURVE(LogC3Family, 160,  0.005561f, 5.555556f, 0.080216f, 0.269036f, 0.381991f, 5.842037f, 0.092778f)
+LOGCTOOL_LOGC_CURVE(LogC3Family, 200,  0.006208f, 5.555556f, 0.076621f, 0.266007f, 0.382478f, 5.776265f, 0.092782f)
+LOGCTOOL_LOGC_CURVE(LogC3Family, 250,  0.006871f, 5.555556f, 0.072941f, 0.262978f, 0.382966f, 5.710494f, 0.092786f)
+LOGCTOOL_LOGC_CURVE(LogC3Family, 320,  0.007622f, 5.555556f, 0.068768f, 0.259627f, 0.383508f, 5.637732f, 0.092791f)
+LOGCTOOL_LOGC_CURVE(LogC3Family, 400,  0.008318f, 5.555556f, 0.064901f, 0.256598f, 0.383999f, 5.571960f, 0.092795f)
+LOGCTOOL_LOGC_CURVE(LogC3Family, 500,  0.009031f, 5.555556f, 0.060939f, 0.253569f, 0.384493f, 5.506188f, 0.092800f)
+LOGCTOOL_LOGC_CURVE(LogC3Family, 640,  0.009840f, 5.555556f, 0.056443f, 0.250219f, 0.385040f, 5.433426f, 0.092805f)
+//                                800   default gamma
+LOGCTOOL_LOGC_CURVE(LogC3Family, 800,  0.010591f, 5.555556f, 0.052272f, 0.247190f, 0.385537f, 5.367655f, 0.092809f)
+LOGCTOOL_LOGC_CURVE(LogC3Family, 1000, 0.011361f, 5.555556f, 0.047996f, 0.244161f, 0.386036f, 5.301883f, 0.092814f)
+LOGCTOOL_LOGC_CURVE(LogC3Family, 1280, 0.012235f, 5.555556f, 0.043137f, 0.240810f, 0.386590f, 5.229121f, 0.092819f)
+LOGCTOOL_LOGC_CURVE(LogC3Family, 1600, 0.013047f, 5.555556f, 0.038625f, 0.237781f, 0.387093f, 5.163350f, 0.092824f)
+
+#undef LOGCTOOL_LOGC_CURVE
+
+template <typename Family, typename Kernel>
+bool logc_curve(int, Kernel&&, LogCTable<>)
+{
+    return false;
+}
+
+template <typename Family, typename Kernel, int EI, int... Table>
+bool logc_curve(int ei, Kernel&& kernel, LogCTable<EI, Table...>)
+{
+    if (ei == EI) {
+        kernel(LogCCurve<Family, EI>());
+        return true;
+    }
+    return logc_curve<Family>(ei, kernel, LogCTable<Table...>());
+}
+
+// calls kernel with the curve policy of ei in the family table, false for an unknown ei
+template <typename Family, typename Kernel>
+bool logc_curve(int ei, Kernel&& kernel)
+{
+    return logc_curve<Family>(ei, kernel, typename Family::Table());
+}
+
+// specialized kernel when the coefficients match the table, else runtime coefficients
+template <typename Family, typename Kernel>
+void logc_curve(const typename Family::Colorspace& colorspace, Kernel&& kernel)
+{
+    bool specialized = false;
+    logc_curve<Family>(colorspace.ei, [&](auto curve) {
+        if (curve.colorspace() == colorspace) {
+            kernel(curve);
+            specialized = true;
+        }
+    });
+    if (!specialized) {
+        kernel(colorspace);
+    }
+}
+
+template <typename Kernel>
+bool logc3_curve(int ei, Kernel&& kernel)
+{
+    return logc_curve<LogC3Family>(ei, kernel);
+}
+
+template <typename Kernel>
+void logc3_curve(const LogC3Colorspace& colorspace, Kernel&& kernel)
+{
+    logc_curve<LogC3Family>(colorspace, kernel);
+}
+
+bool logc3_colorspace(int ei, LogC3Colorspace& colorspace);
+
+// lut transform
+struct LutTransform
+{
+    std::string description;
+    std::string filename;
+};
+
+// patch
+struct Patch
+{
+    int no;
+    std::string name;
+    float cieLabd50_l;
+    float cieLabd50_a;
+    float cieLabd50_b;
+    // optional
+    float sRGB_r;
+    float sRGB_g;
+    float sRGB_b;
+    float munsell_hue;
+    float munsell_value;
+    float munsell_chroma;
+};
+
+std::vector<Patch> load_patches(const std::string& jsonfile);
+
+// patch layout
+struct PatchLayout
+{
+    std::string patchfile;
+    int patchcount;
+    int patchrows;
+    int patchcols;
+    int patchwidth;
+    int patchheight;
+    int spacing;
+    int referencex;
+    int referenceheight;
+    int white_index;
+    int black_index;
+    bool row_order;
+    float sizecode;
+    float sizelabel;
+};
+
+bool patch_layout(const std::string& outputtype, int width, int height, PatchLayout& layout);
+bool patch_grid(const std::vector<Patch>& patches, int width, int height, PatchLayout& layout);
+OIIO::ROI patch_roi(const PatchLayout& layout, int row, int col);
+OIIO::ROI reference_roi(const PatchLayout& layout, int width, int i);
+int patch_index(const PatchLayout& layout, int row, int col); // -1 for empty grid cells
+
+// patch rectangles in chart coordinates, grid then references
+struct PatchRect
+{
+    int no;
+    OIIO::ROI roi;
+};
+
+std::vector<PatchRect> patch_rects(const PatchLayout& layout, int width);
+Imath::Vec3<float> patch_color(
+    const Patch& patch,
+    LogC3Colorspace& colorspace,
+    bool outputlinear,
+    const OCIO_NAMESPACE::ConstCPUProcessorRcPtr& transformProcessor,
+    float gain = 1.0f);
+
+// data format
+struct DataFormat
+{
+    std::string name;
+    OIIO::TypeDesc typedesc = OIIO::TypeDesc::UNKNOWN;
+    bool is10bit = false;
+    float typelimit = 0.0f;
+};
+
+bool data_format(const std::string& name, DataFormat& format);
+int value_to_code(float value, const DataFormat& format);
+std::string code_to_str(float value, const DataFormat& format);
+std::string code_to_str(const Imath::Vec3<float>& out, const DataFormat& format);
+std::string signal_to_str(float value, const DataFormat& format);
+
+// buffer pool, size classes recycled across jobs and frames, contents undefined
+std::shared_ptr<void> pool_buffer(size_t bytes);
+std::shared_ptr<void> pool_image(OIIO::ImageBuf& imageBuf, const OIIO::ImageSpec& spec, bool zero = false);
+
+// mapped read, uncompressed 10 bit filled and 16 bit dpx decoded to float as read(FLOAT), false for other files
+bool read_mapped(const std::string& filename, OIIO::ImageBuf& imageBuf, std::shared_ptr<void>& buffer);
+
+// trace, chrome trace event spans per thread, recorded once enabled
+struct TraceJob
+{
+    std::string job;
+    std::string chart;
+};
+
+struct TraceSpan
+{
+    TraceSpan(const char* name, const char* category, const std::string& detail = "");
+    ~TraceSpan();
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+    
+    const char* name;
+    const char* category;
+    std::string detail;
+    int64_t start;
+};
+
+void trace_enable();
+bool trace_enabled();
+void trace_thread(const std::string& name);
+TraceJob trace_job();
+void trace_job(const TraceJob& job); // job and chart of spans on this thread
+bool write_trace(const std::string& filename);
+
+// quantize, into dst when initialized (caller-owned) or allocated
+void float_to_half(const float* src, uint16_t* dst, size_t count);
+bool quantize_image(
+    OIIO::ImageBuf& dst,
+    const OIIO::ImageBuf& src,
+    const DataFormat& format,
+    OCIO_NAMESPACE::OptimizationFlags optimization = OCIO_NAMESPACE::OPTIMIZATION_DEFAULT);
+bool write_image(const OIIO::ImageBuf& imageBuf, const std::string& filename);
+
+// sidecar
+template <typename T>
+boost::property_tree::ptree sidecar_array(const std::vector<T>& values)
+{
+    boost::property_tree::ptree array;
+    for (const T& value : values) {
+        boost::property_tree::ptree item;
+        item.put("", value);
+        array.push_back(std::make_pair("", item));
+    }
+    return array;
+}
+
+boost::property_tree::ptree sidecar_code(const Imath::Vec3<float>& out, const DataFormat& format);
+boost::property_tree::ptree sidecar_patch(
+    const Patch& patch,
+    const OIIO::ROI& roi,
+    const Imath::Vec3<float>& out,
+    const DataFormat& format);
+bool write_sidecar(const std::string& filename, const boost::property_tree::ptree& pt);
+
+// region, clipped to the data window of the image
+bool clip_roi(const OIIO::ImageBuf& imageBuf, OIIO::ROI& roi);
+bool strip_roi(int width, int height, int strip, int strips, OIIO::ROI& roi);
+
+// stepchart
+struct StepStop
+{
+    int stop;
+    int x;
+    float lin;
+    float log;
+    float value;
+};
+
+float gray_value(float log, const OCIO_NAMESPACE::ConstCPUProcessorRcPtr& transformProcessor);
+std::vector<StepStop> stepchart_stops(
+    int width,
+    float midgray,
+    LogC3Colorspace& colorspace,
+    bool outputlinear,
+    const OCIO_NAMESPACE::ConstCPUProcessorRcPtr& transformProcessor);
+OIIO::ROI stepchart_roi(int width, int height, int signalsize, int s);
+
+// resources
+struct Resources
+{
+    std::map<std::string, LutTransform> transforms;
+    std::map<std::string, OCIO_NAMESPACE::ConstCPUProcessorRcPtr> processors;
+    std::map<std::string, std::vector<Patch>> patches;
+    std::mutex mutex;
+};
+
+bool load_transforms(Resources& resources);
+std::string transform_filename(const Resources& resources, const std::string& name); // name or lut file
+// optimization is default, none, lossless, verygood, good or draft
+bool ocio_optimization(const std::string& name, OCIO_NAMESPACE::OptimizationFlags& optimization);
+// name is a comma separated chain, baked into one 3d lut of bakesize when set
+OCIO_NAMESPACE::ConstCPUProcessorRcPtr transform_processor(
+    Resources& resources,
+    const std::string& name,
+    int bakesize = 0,
+    OCIO_NAMESPACE::OptimizationFlags optimization = OCIO_NAMESPACE::OPTIMIZATION_DEFAULT);
+std::vector<Patch> patch_set(Resources& resources, const std::string& patchfile);
+
+// custom outputtype lays out any patch file on an auto grid
+bool chart_patches(
+    const std::string& outputtype,
+    const std::string& patchfile,
+    int width,
+    int height,
+    Resources& resources,
+    PatchLayout& layout,
+    std::vector<Patch>& patches,
+    std::string& error);
+
+// chart, format independent float master
+struct Chart
+{
+    std::string outputtype = "stepchart";
+    LogC3Colorspace colorspace;
+    float midgray = 0.18f;
+    std::string transform;
+    bool outputlinear = false;
+    bool outputnolabels = false;
+    OCIO_NAMESPACE::ConstCPUProcessorRcPtr transformProcessor;
+    OCIO_NAMESPACE::OptimizationFlags optimization = OCIO_NAMESPACE::OPTIMIZATION_DEFAULT; // quantize processor
+    std::string patchfile; // overrides the patch set of the output type
+    std::vector<StepStop> stops;
+    PatchLayout layout;
+    std::vector<Patch> patches;
+    std::vector<Imath::Vec3<float>> colors;
+    OIIO::ROI roi; // region in chart coordinates, undefined for all
+    float exposure = 0.0f; // stops, applied in scene linear
+    OIIO::ImageSpec spec;
+    std::shared_ptr<void> masterData; // pooled, outlives masterBuf
+    OIIO::ImageBuf masterBuf;
+};
+
+// prepare once, then values per exposure and labels once
+bool prepare_chart(Chart& chart, int width, int height, int channels, Resources& resources, std::string& error);
+void render_chart_values(Chart& chart);
+void render_chart_labels(const Chart& chart, OIIO::ImageBuf& imageBuf);
+bool render_chart(Chart& chart, int width, int height, int channels, Resources& resources, std::string& error);
+void render_overlay(const Chart& chart, OIIO::ImageBuf& overlayBuf);
+void composite_overlay(OIIO::ImageBuf& imageBuf, const OIIO::ImageBuf& overlayBuf);
+bool render_output(
+    OIIO::ImageBuf& imageBuf,
+    const Chart& chart,
+    const DataFormat& format,
+    const std::string& filename);
+
+// cube lut, type is falsecolor or stops
+std::vector<float> cube_lut_values(
+    const std::string& type,
+    int size,
+    LogC3Colorspace& colorspace,
+    float midgray,
+    const OCIO_NAMESPACE::ConstCPUProcessorRcPtr& transformProcessor);
+// luma lut, type is falsecolor or stops, indexed by rec709 luma
+std::vector<float> luma_lut_values(
+    const std::string& type,
+    int size,
+    LogC3Colorspace& colorspace,
+    float midgray,
+    const OCIO_NAMESPACE::ConstCPUProcessorRcPtr& transformProcessor);
+// inverse cube lut, transform output to logc3, solved per lattice point
+struct InverseError
+{
+    float max = 0.0f;
+    float mean = 0.0f;
+    int unreachable = 0; // lattice points outside of the transform range
+};
+
+std::vector<float> inverse_lut_values(
+    int size,
+    const OCIO_NAMESPACE::ConstCPUProcessorRcPtr& transformProcessor,
+    InverseError& error);
+
+// type is falsecolor, stops or inverse
+bool write_cube_lut(
+    const std::string& filename,
+    const std::string& type,
+    const std::vector<float>& values,
+    int size,
+    int ei,
+    const std::string& transform,
+    const std::string& hash = "");
+
+// 1d luma lut, .clf files include the luma matrix, .cube files expect luma input
+bool write_luma_lut(
+    const std::string& filename,
+    const std::string& type,
+    const std::vector<float>& values,
+    int size,
+    int ei,
+    const std::string& transform,
+    const std::string& hash = "");
+
+// cache, sha1 of values and file contents
+std::string content_hash(const std::vector<std::string>& values, const std::vector<std::string>& files);
+
+}
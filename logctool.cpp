@@ -6,9 +6,35 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <list>
+#include <map>
+#include <iomanip>
+#include <limits>
+#include <cerrno>
 #include <cmath>
+#include <cstring>
 #include <regex>
 #include <variant>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <queue>
+#include <condition_variable>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
 
 // imath
 #include <Imath/ImathMatrix.h>
@@ -20,15 +46,17 @@
 #include <OpenImageIO/argparse.h>
 #include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/sysutil.h>
+#include <OpenImageIO/strutil.h>
 
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
+#include <OpenImageIO/parallel.h>
 
 using namespace OIIO;
 
 // opencolorio
 #include <OpenColorIO/OpenColorIO.h>
-using namespace OpenColorIO_v2_3;
+using namespace OCIO_NAMESPACE;
 
 // boost
 #include <boost/property_tree/ptree.hpp>
@@ -36,39 +64,10 @@ using namespace OpenColorIO_v2_3;
 
 using namespace boost::property_tree;
 
-// prints
-template <typename T>
-static void
-print_info(std::string param, const T& value = T()) {
-    std::cout << "info: " << param << value << std::endl;
-}
-
-static void
-print_info(std::string param) {
-    print_info<std::string>(param);
-}
-
-template <typename T>
-static void
-print_warning(std::string param, const T& value = T()) {
-    std::cout << "warning: " << param << value << std::endl;
-}
+// logctool
+#include "liblogctool_internal.h"
 
-static void
-print_warning(std::string param) {
-    print_warning<std::string>(param);
-}
-
-template <typename T>
-static void
-print_error(std::string param, const T& value = T()) {
-    std::cerr << "error: " << param << value << std::endl;
-}
-
-static void
-print_error(std::string param) {
-    print_error<std::string>(param);
-}
+using namespace logctool;
 
 // logc tool
 struct LogCTool
@@ -83,12 +82,47 @@ struct LogCTool
     float midgray = 0.18;
     std::string dataformat = "float";
     std::string transform;
+    int transformbake = 0;
+    std::string optimization = "default";
+    int preview = 0;
+    bool previewfull = false;
+    std::string lutfile;
+    std::string patchfile;
     std::string outputtype = "stepchart";
     std::string outputfilename;
+    std::vector<std::string> outputs;
     std::string outputfalsecolorcubefile;
     std::string outputstopscubefile;
+    std::string outputinversecubefile;
+    int inversecubesize = 33;
+    int lumalutsize = 0;
+    std::string trace;
+    std::string jobid;
     bool outputlinear = false;
     bool outputnolabels = false;
+    std::string verifyfilename;
+    std::string characterize;
+    std::string characterizefile;
+    float verifytolerance = 0.0f;
+    std::string sidecarfilename;
+    std::string outputshm;
+    std::string outputstream;
+    std::string streamformat = "rgb48le";
+    int streamfps = 24;
+    std::string sweep;
+    bool serve = false;
+    std::string servesocket;
+    int threads = 0;
+    int codecthreads = 0;
+    std::string compression;
+    std::string tile;
+    std::string encodereport;
+    std::string roi;
+    std::string strip;
+    std::string labelname;
+    std::vector<std::string> merge;
+    bool cache = false;
+    std::string cacheindex;
     int code = EXIT_SUCCESS;
 };
 
@@ -100,471 +134,2133 @@ print_help(ArgParse& ap)
     ap.print_help();
 }
 
-std::string datetime()
+// output
+struct Output
 {
-    std::time_t now = time(NULL);
-    struct tm tm;
-    Sysutil::get_local_time(&now, &tm);
-    char datetime[20];
-    strftime(datetime, 20, "%Y-%m-%d %H:%M:%S", &tm);
-    return std::string(datetime);
+    std::string filename;
+    DataFormat format;
+    std::string shm;
+    std::string stream;
+    std::string hash;
+};
+
+// output image, pooled buffer outlives the image
+struct OutputImage
+{
+    std::shared_ptr<void> buffer;
+    ImageBuf imageBuf;
+};
+
+bool render_output_image(OutputImage& image, const Chart& chart, const DataFormat& format, const std::string& filename)
+{
+    ImageSpec spec = chart.spec;
+    spec.set_format(format.typedesc);
+    image.buffer = pool_image(image.imageBuf, spec);
+    return render_output(image.imageBuf, chart, format, filename);
+}
+
+// verify sample
+struct VerifySample
+{
+    std::string name;
+    ROI roi;
+    Imath::Vec3<float> expected;
+    Imath::Vec3<float> measured;
+    float delta = 0.0f;
+    float deltae = -1.0f;
+};
+
+ROI sample_roi(const ROI& roi, float x0, float x1, float y0, float y1)
+{
+    // inner region of a patch, away from edges and labels
+    const int w = roi.width();
+    const int h = roi.height();
+    ROI sample(
+        roi.xbegin + (int)(w * x0), roi.xbegin + std::max(1, (int)(w * x1)),
+        roi.ybegin + (int)(h * y0), roi.ybegin + std::max(1, (int)(h * y1)));
+    sample.chend = 3;
+    return sample;
+}
+
+Imath::Vec3<float> code_to_lab(
+    const Imath::Vec3<float>& code,
+    LogC3Colorspace& colorspace,
+    bool outputlinear
+) {
+    Imath::Vec3<float> awg =
+        outputlinear
+            ? code
+            : Imath::Vec3<float>(colorspace.log2lin(code.x),
+                                 colorspace.log2lin(code.y),
+                                 colorspace.log2lin(code.z));
+    return d50_to_lab(d65_to_d50(colorspace.awg3_from_xyz(awg)));
 }
 
-Imath::Vec3<float> hsv_to_rgb(const Imath::Vec3<float>& hsv) {
-    float hue = hsv.x;
-    float saturation = hsv.y;
-    float value = hsv.z;
-    if (hue < std::numeric_limits<float>::epsilon()) {
-        return Imath::Vec3<float>(0, 0, 0);
+int verify_chart(
+    const std::string& filename,
+    const std::string& outputtype,
+    const std::string& patchfile,
+    Resources& resources,
+    LogC3Colorspace& colorspace,
+    float midgray,
+    const DataFormat& format,
+    bool outputlinear,
+    const ConstCPUProcessorRcPtr& transformProcessor,
+    float tolerance
+) {
+    print_info("verifying file: ", filename);
+    
+    // uncompressed dpx is mapped, else read through oiio
+    ImageBuf imageBuf;
+    std::shared_ptr<void> buffer;
+    {
+        TraceSpan span("read", "io", filename);
+        if (!read_mapped(filename, imageBuf, buffer)) {
+            imageBuf.reset(filename);
+            if (!imageBuf.read(0, 0, true, TypeDesc::FLOAT)) {
+                print_error("could not read file: ", imageBuf.geterror());
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    TraceSpan span("verify", "verify", filename);
+    if (imageBuf.nchannels() < 3) {
+        print_error("could not verify file, expected 3 channels, is now: ", imageBuf.nchannels());
+        return EXIT_FAILURE;
     }
     
-    int hi = static_cast<int>(std::floor(hue / 60.0f)) % 6;
-    float f = hue / 60.0f - static_cast<float>(hi);
-    float p = value * (1.0f - saturation);
-    float q = value * (1.0f - f * saturation);
-    float t = value * (1.0f - (1.0f - f) * saturation);
-
-    float r, g, b;
-    switch (hi) {
-        case 0: r = value; g = t; b = p; break;
-        case 1: r = q; g = value; b = p; break;
-        case 2: r = p; g = value; b = t; break;
-        case 3: r = p; g = q; b = value; break;
-        case 4: r = t; g = p; b = value; break;
-        case 5: r = value; g = p; b = q; break;
+    const int width = imageBuf.spec().width;
+    const int height = imageBuf.spec().height;
+    std::vector<VerifySample> samples;
+    
+    if (outputtype == "stepchart") {
+        std::vector<StepStop> stops =
+            stepchart_stops(width, midgray, colorspace, outputlinear, transformProcessor);
+        for(int s=0; s<(int)stops.size(); s++) {
+            const StepStop& stop = stops[s];
+            VerifySample sample;
+            sample.name = "stop " + int_to_str(stop.stop);
+            sample.roi = sample_roi(stepchart_roi(width, height, stops.size(), s),
+                                    0.25f, 0.75f, 0.4f, 0.7f);
+            sample.expected = Imath::Vec3<float>(stop.value, stop.value, stop.value);
+            samples.push_back(sample);
+        }
     }
-
-    return Imath::Vec3<float>(r, g, b);
+    else {
+        PatchLayout layout;
+        std::vector<Patch> patches;
+        std::string error;
+        if (!chart_patches(outputtype, patchfile, width, height, resources, layout, patches, error)) {
+            print_error(error);
+            return EXIT_FAILURE;
+        }
+        for (int row = 0; row < layout.patchrows; ++row) {
+            for (int col = 0; col < layout.patchcols; ++col) {
+                const int no = patch_index(layout, row, col);
+                if (no < 0) {
+                    continue;
+                }
+                const Patch& patch = patches[no];
+                VerifySample sample;
+                sample.name = patch.name;
+                sample.roi = sample_roi(patch_roi(layout, row, col), 0.2f, 0.8f, 0.1f, 0.35f);
+                sample.expected = patch_color(patch, colorspace, outputlinear, transformProcessor);
+                samples.push_back(sample);
+            }
+        }
+        const int indices[2] = { layout.white_index, layout.black_index };
+        for (int i = 0; i < 2; ++i) {
+            const Patch& patch = patches[indices[i]];
+            VerifySample sample;
+            sample.name = patch.name + " (reference)";
+            sample.roi = sample_roi(reference_roi(layout, width, i), 0.2f, 0.8f, 0.1f, 0.35f);
+            sample.expected = patch_color(patch, colorspace, outputlinear, transformProcessor);
+            samples.push_back(sample);
+        }
+    }
+    
+    // code values are compared in the scale of the data format
+    float codescale = 1.0f;
+    if (!format.typedesc.is_floating_point()) {
+        codescale = format.is10bit ? 1023.0f : format.typelimit;
+    }
+    if (tolerance <= 0.0f) {
+        tolerance = format.typedesc.is_floating_point() ? 0.001f : 1.0f;
+    }
+    
+    parallel_for(0, (int64_t)samples.size(), [&](int64_t i) {
+        VerifySample& sample = samples[i];
+        ImageBufAlgo::PixelStats stats;
+        ImageBufAlgo::computePixelStats(stats, imageBuf, sample.roi, 1);
+        sample.measured = Imath::Vec3<float>(stats.avg[0], stats.avg[1], stats.avg[2]);
+        for (int c = 0; c < 3; c++) {
+            sample.delta = std::max(sample.delta,
+                                    std::abs(sample.measured[c] - sample.expected[c]) * codescale);
+        }
+        if (!transformProcessor) {
+            sample.deltae = delta_e(code_to_lab(sample.expected, colorspace, outputlinear),
+                                    code_to_lab(sample.measured, colorspace, outputlinear));
+        }
+    });
+    
+    int failed = 0;
+    float maxdelta = 0.0f;
+    float maxdeltae = 0.0f;
+    int precision = format.typedesc.is_floating_point() ? 4 : 1;
+    for (const VerifySample& sample : samples) {
+        bool passed = sample.delta <= tolerance;
+        if (!passed) {
+            failed++;
+        }
+        maxdelta = std::max(maxdelta, sample.delta);
+        maxdeltae = std::max(maxdeltae, sample.deltae);
+        std::string deltae = sample.deltae < 0.0f ? "n/a" : float_to_str(sample.deltae);
+        print_info(std::string(passed ? " pass: " : " fail: ") + sample.name + ": ",
+                   "expected: " + code_to_str(sample.expected, format) +
+                   " measured: " + code_to_str(sample.measured, format) +
+                   " delta: " + float_to_str(sample.delta, precision) +
+                   " deltaE: " + deltae);
+    }
+    print_info("verify patches: ", samples.size());
+    print_info("verify max delta: ", float_to_str(maxdelta, precision));
+    if (!transformProcessor) {
+        print_info("verify max deltaE: ", float_to_str(maxdeltae));
+    }
+    if (failed) {
+        print_error("verify failed patches: ", failed);
+        return EXIT_FAILURE;
+    }
+    print_info("verify passed");
+    return EXIT_SUCCESS;
 }
 
-float pow_gamma(float value, float gamma) {
-    return pow(value, gamma);
+// characterize
+int characterize_transform(
+    const std::string& transform,
+    const std::string& filename,
+    LogC3Colorspace& colorspace,
+    float midgray,
+    const DataFormat& format,
+    const ConstCPUProcessorRcPtr& transformProcessor
+) {
+    print_info("characterizing transform: ", transform);
+    
+    // dense gray sweep across -8 to +8 stops, processed in batches
+    const int samplesperstop = 1 << 16;
+    const int nsamples = 16 * samplesperstop + 1;
+    const int batchsize = 4096;
+    const float dstop = 1.0f / samplesperstop;
+    std::vector<float> logs(nsamples);
+    std::vector<float> rgb((size_t)nsamples * 3);
+    logc3_curve(colorspace, [&](auto curve) {
+        parallel_for(0, (nsamples + batchsize - 1) / batchsize, [&](int64_t batch) {
+            const int begin = batch * batchsize;
+            const int end = std::min(nsamples, begin + batchsize);
+            for (int i = begin; i < end; i++) {
+                float log = curve.lin2log(pow(2.0f, -8.0f + i * dstop) * midgray);
+                logs[i] = log;
+                rgb[i * 3] = rgb[i * 3 + 1] = rgb[i * 3 + 2] = log;
+            }
+            PackedImageDesc desc(&rgb[(size_t)begin * 3], end - begin, 1, 3);
+            transformProcessor->apply(desc);
+        });
+    });
+    auto stop_of = [&](int i) { return -8.0f + i * dstop; };
+    auto value_of = [&](int i) { return Imath::Vec3<float>(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]); };
+    auto gray_of = [&](int i) { return 0.2126f * rgb[i * 3] + 0.7152f * rgb[i * 3 + 1] + 0.0722f * rgb[i * 3 + 2]; };
+    
+    // monotonicity per sample, slope per 1/64 stop
+    const float tolerance = 1e-6f;
+    const int slopestep = samplesperstop / 64;
+    int decreasing = 0;
+    for (int i = 1; i < nsamples; i++) {
+        if (gray_of(i) < gray_of(i - 1) - tolerance) {
+            decreasing++;
+        }
+    }
+    float minslope = std::numeric_limits<float>::max();
+    float maxslope = -std::numeric_limits<float>::max();
+    for (int i = slopestep; i < nsamples; i += slopestep) {
+        float slope = (gray_of(i) - gray_of(i - slopestep)) / (slopestep * dstop);
+        minslope = std::min(minslope, slope);
+        maxslope = std::max(maxslope, slope);
+    }
+    
+    // clipping, where the response stops changing at either end
+    int white = nsamples - 1;
+    while (white > 0 && std::abs(gray_of(white - 1) - gray_of(nsamples - 1)) <= tolerance) {
+        white--;
+    }
+    int black = 0;
+    while (black < nsamples - 1 && std::abs(gray_of(black + 1) - gray_of(0)) <= tolerance) {
+        black++;
+    }
+    
+    // rgb lattice over the log domain, out of range and extremes
+    const int size = 33;
+    std::vector<float> lattice((size_t)size * size * size * 3);
+    parallel_for(0, size, [&](int64_t b) {
+        float* slice = &lattice[(size_t)b * size * size * 3];
+        for (int g = 0; g < size; g++) {
+            for (int r = 0; r < size; r++) {
+                float* value = slice + ((size_t)g * size + r) * 3;
+                value[0] = (float)r / (size - 1);
+                value[1] = (float)g / (size - 1);
+                value[2] = (float)b / (size - 1);
+            }
+        }
+        PackedImageDesc desc(slice, size * size, 1, 3);
+        transformProcessor->apply(desc);
+    });
+    int outofrange = 0;
+    Imath::Vec3<float> latticemin(std::numeric_limits<float>::max());
+    Imath::Vec3<float> latticemax(-std::numeric_limits<float>::max());
+    for (size_t i = 0; i < lattice.size(); i++) {
+        const int c = i % 3;
+        latticemin[c] = std::min(latticemin[c], lattice[i]);
+        latticemax[c] = std::max(latticemax[c], lattice[i]);
+        if (lattice[i] < 0.0f || lattice[i] > 1.0f) {
+            outofrange++;
+        }
+    }
+    
+    print_info("characterize samples: ", nsamples);
+    print_info("characterize min slope: ", float_to_str(minslope, 4));
+    print_info("characterize max slope: ", float_to_str(maxslope, 4));
+    print_info("characterize monotonic: ", decreasing ? "no, decreasing samples: " + int_to_str(decreasing) : "yes");
+    print_info("characterize black clip stop: ", black > 0 ? float_to_str(stop_of(black)) : "none");
+    print_info("characterize white clip stop: ", white < nsamples - 1 ? float_to_str(stop_of(white)) : "none");
+    print_info("characterize lattice out of range: ", outofrange);
+    
+    // per stop output
+    for (int stop = -8; stop <= 8; stop++) {
+        const int i = (stop + 8) * samplesperstop;
+        print_info(" stop " + int_to_str(stop) + ": ", code_to_str(value_of(i), format));
+    }
+    
+    if (filename.empty()) {
+        return EXIT_SUCCESS;
+    }
+    print_info("writing characterize file: ", filename);
+    
+    // curve table per 1/64 stop
+    if (Filesystem::extension(filename) == ".json") {
+        ptree pt;
+        pt.put("logctool.datetime", datetime());
+        pt.put("transform", transform);
+        pt.put("ei", colorspace.ei);
+        pt.put("midgray", midgray);
+        pt.put("dataformat", format.name);
+        pt.put("summary.samples", nsamples);
+        pt.put("summary.minslope", minslope);
+        pt.put("summary.maxslope", maxslope);
+        pt.put("summary.monotonic", decreasing == 0);
+        pt.put("summary.decreasing", decreasing);
+        if (black > 0) {
+            pt.put("summary.blackclip", stop_of(black));
+        }
+        if (white < nsamples - 1) {
+            pt.put("summary.whiteclip", stop_of(white));
+        }
+        pt.put("lattice.size", size);
+        pt.put("lattice.outofrange", outofrange);
+        pt.add_child("lattice.min", sidecar_array(std::vector<float> { latticemin.x, latticemin.y, latticemin.z }));
+        pt.add_child("lattice.max", sidecar_array(std::vector<float> { latticemax.x, latticemax.y, latticemax.z }));
+        ptree stops;
+        for (int stop = -8; stop <= 8; stop++) {
+            const int i = (stop + 8) * samplesperstop;
+            ptree item = sidecar_code(value_of(i), format);
+            item.put("stop", stop);
+            item.put("log", logs[i]);
+            stops.push_back(std::make_pair("", item));
+        }
+        pt.add_child("stops", stops);
+        ptree curve;
+        for (int i = 0; i < nsamples; i += slopestep) {
+            ptree item = sidecar_code(value_of(i), format);
+            item.put("stop", stop_of(i));
+            item.put("log", logs[i]);
+            curve.push_back(std::make_pair("", item));
+        }
+        pt.add_child("curve", curve);
+        if (!write_sidecar(filename, pt)) {
+            print_error("could not open characterize file: ", filename);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    std::ofstream outputFile(filename);
+    if (!outputFile) {
+        print_error("could not open characterize file: ", filename);
+        return EXIT_FAILURE;
+    }
+    outputFile << "# transform: " << transform << std::endl;
+    outputFile << "# ei: " << colorspace.ei << std::endl;
+    outputFile << "# min slope: " << minslope << std::endl;
+    outputFile << "# max slope: " << maxslope << std::endl;
+    outputFile << "# decreasing samples: " << decreasing << std::endl;
+    outputFile << "# black clip stop: " << (black > 0 ? float_to_str(stop_of(black)) : "none") << std::endl;
+    outputFile << "# white clip stop: " << (white < nsamples - 1 ? float_to_str(stop_of(white)) : "none") << std::endl;
+    outputFile << "# lattice out of range: " << outofrange << std::endl;
+    outputFile << "stop,log,r,g,b" << std::endl;
+    outputFile << std::setprecision(8);
+    for (int i = 0; i < nsamples; i += slopestep) {
+        outputFile << stop_of(i) << "," << logs[i] << ","
+                   << rgb[i * 3] << "," << rgb[i * 3 + 1] << "," << rgb[i * 3 + 2] << std::endl;
+    }
+    return EXIT_SUCCESS;
 }
 
-int _10bit_to_int(int value)
+// merge
+int merge_strips(const std::vector<std::string>& filenames, const std::string& outputfilename)
 {
-    return (value >> 6); // bit shift by 6 for 10 bit representation
+    if (outputfilename.empty()) {
+        print_error("missing parameter: ", "outputfilename");
+        return EXIT_FAILURE;
+    }
+    ImageBuf mergeBuf;
+    int64_t pixels = 0;
+    for (const std::string& filename : filenames) {
+        print_info("merging strip file: ", filename);
+        
+        ImageBuf stripBuf(filename);
+        if (!stripBuf.read(0, 0, true)) {
+            print_error("could not read file: ", stripBuf.geterror());
+            return EXIT_FAILURE;
+        }
+        const ImageSpec& spec = stripBuf.spec();
+        if (!mergeBuf.initialized()) {
+            // strips carry the full chart as display window, pixels are copied as is
+            ImageSpec mergespec = spec;
+            mergespec.x = spec.full_x;
+            mergespec.y = spec.full_y;
+            mergespec.width = spec.full_width;
+            mergespec.height = spec.full_height;
+            mergespec.erase_attribute("logctool:hash"); // hash of the strip, not the merge
+            mergeBuf.reset(mergespec);
+        }
+        else if (spec.format != mergeBuf.spec().format
+                 || spec.nchannels != mergeBuf.spec().nchannels
+                 || spec.full_width != mergeBuf.spec().full_width
+                 || spec.full_height != mergeBuf.spec().full_height) {
+            print_error("strip does not match previous strips: ", filename);
+            return EXIT_FAILURE;
+        }
+        if (!ImageBufAlgo::paste(mergeBuf, spec.x, spec.y, 0, 0, stripBuf)) {
+            print_error("could not merge strip: ", mergeBuf.geterror());
+            return EXIT_FAILURE;
+        }
+        pixels += (int64_t)spec.width * spec.height;
+    }
+    if (!mergeBuf.initialized()) {
+        print_error("no strips to merge");
+        return EXIT_FAILURE;
+    }
+    const int64_t npixels = (int64_t)mergeBuf.spec().width * mergeBuf.spec().height;
+    if (pixels < npixels) {
+        print_warning("strips do not cover the full image, missing pixels: ", npixels - pixels);
+    }
+    return write_image(mergeBuf, outputfilename) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-std::string float_to_str(float value)
+// shared memory
+bool write_shm(const ImageBuf& imageBuf, const std::string& name)
 {
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(2) << value;
-    return oss.str();
+    print_info("writing output shared memory: ", name);
+#if !defined(_WIN32)
+    const size_t size = imageBuf.spec().image_bytes();
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        print_error("could not open shared memory: ", name);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < size) {
+        print_error("shared memory is smaller than image, expected bytes: ", size);
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, size, PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        print_error("could not map shared memory: ", name);
+        return false;
+    }
+    bool copied = imageBuf.get_pixels(imageBuf.roi(), imageBuf.spec().format, data);
+    munmap(data, size);
+    if (!copied) {
+        print_error("could not copy pixels to shared memory: ", imageBuf.geterror());
+    }
+    return copied;
+#else
+    print_error("shared memory output is not supported on this platform: ", name);
+    return false;
+#endif
 }
 
-std::string percent_to_str(float value)
+// frame stream
+struct FrameStream
 {
-    std::ostringstream oss;
-    oss << static_cast<int>(value * 100) << '%';
-    return oss.str();
-}
+    std::string path;
+    std::string format;
+    FILE* file = nullptr;
+    bool header = false;
+    std::vector<char> buffer;
+};
 
-std::string int_to_str(int value)
+bool stream_format(const std::string& name, DataFormat& format)
 {
-    return std::to_string(value);
+    // raw frames are packed from the quantized output image
+    if (name == "rgb24") {
+        return data_format("uint8", format);
+    }
+    else if (name == "rgb48le") {
+        return data_format("uint16", format);
+    }
+    else if (name == "gbrpf32" || name == "y4m") {
+        return data_format("float", format);
+    }
+    return false;
 }
 
-std::string _10bit_to_str(int value)
+bool open_stream(FrameStream& stream, const std::string& path, const std::string& format)
 {
-    return std::to_string(_10bit_to_int(value)); // 10bit stored 16bit and bitshifted for strings
+    stream.path = path;
+    stream.format = format;
+    stream.header = false;
+    if (path == "-") {
+#if defined(_WIN32)
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        stream.file = stdout;
+    } else {
+        stream.file = fopen(path.c_str(), "wb"); // fifo blocks until a reader opens
+    }
+    if (!stream.file) {
+        print_error("could not open output stream: ", path);
+        return false;
+    }
+    setvbuf(stream.file, nullptr, _IOFBF, 1 << 22);
+    return true;
 }
 
-std::string program_path(const std::string& path)
+void close_stream(FrameStream& stream)
 {
-    return Filesystem::parent_path(Sysutil::this_program_path()) + path;
+    if (stream.file) {
+        fflush(stream.file);
+        if (stream.file != stdout) {
+            fclose(stream.file);
+        }
+        stream.file = nullptr;
+    }
 }
 
-std::string font_path(const std::string& font)
+static void to_little_endian(uint16_t* data, size_t count)
 {
-    return Filesystem::parent_path(Sysutil::this_program_path()) + "/fonts/" + font;
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    for (size_t i = 0; i < count; i++) {
+        data[i] = (uint16_t)((data[i] >> 8) | (data[i] << 8));
+    }
+#else
+    (void)data;
+    (void)count;
+#endif
 }
 
-std::string resources_path(const std::string& resource)
+bool write_stream(FrameStream& stream, const ImageBuf& imageBuf, int fps)
 {
-    return Filesystem::parent_path(Sysutil::this_program_path()) + "/resources/" + resource;
+    TraceSpan span("stream", "io");
+    const ImageSpec& spec = imageBuf.spec();
+    const size_t npixels = (size_t)spec.width * spec.height;
+    ROI roi = imageBuf.roi();
+    roi.chend = std::min(3, spec.nchannels);
+    
+    std::string header;
+    if (stream.format == "rgb24" || stream.format == "rgb48le") {
+        // interleaved rgb
+        const TypeDesc type = stream.format == "rgb24" ? TypeDesc::UINT8 : TypeDesc::UINT16;
+        stream.buffer.resize(npixels * 3 * type.size());
+        if (!imageBuf.get_pixels(roi, type, stream.buffer.data())) {
+            print_error("could not pack stream frame: ", imageBuf.geterror());
+            return false;
+        }
+        if (type == TypeDesc::UINT16) {
+            to_little_endian((uint16_t*)stream.buffer.data(), npixels * 3);
+        }
+    }
+    else if (stream.format == "gbrpf32") {
+        // planar float, planes in g, b, r order
+        stream.buffer.resize(npixels * 3 * sizeof(float));
+        const int planes[3] = { 1, 2, 0 };
+        for (int p = 0; p < 3; p++) {
+            ROI plane = roi;
+            plane.chbegin = planes[p];
+            plane.chend = planes[p] + 1;
+            if (!imageBuf.get_pixels(plane, TypeDesc::FLOAT, stream.buffer.data() + p * npixels * sizeof(float))) {
+                print_error("could not pack stream frame: ", imageBuf.geterror());
+                return false;
+            }
+        }
+    }
+    else if (stream.format == "y4m") {
+        // planar 16 bit 4:4:4, full range rec709 y'cbcr
+        std::vector<float> rgb(npixels * 3);
+        if (!imageBuf.get_pixels(roi, TypeDesc::FLOAT, rgb.data())) {
+            print_error("could not pack stream frame: ", imageBuf.geterror());
+            return false;
+        }
+        stream.buffer.resize(npixels * 3 * sizeof(uint16_t));
+        uint16_t* planes = (uint16_t*)stream.buffer.data();
+        auto code = [](float value) -> uint16_t {
+            return (uint16_t)std::lround(std::max(0.0f, std::min(1.0f, value)) * 65535.0f);
+        };
+        parallel_for(0, (int64_t)spec.height, [&](int64_t y) {
+            for (size_t i = y * spec.width; i < (size_t)(y + 1) * spec.width; i++) {
+                const float r = rgb[i * 3];
+                const float g = rgb[i * 3 + 1];
+                const float b = rgb[i * 3 + 2];
+                const float luma = 0.2126f * r + 0.7152f * g + 0.0722f * b;
+                planes[i] = code(luma);
+                planes[npixels + i] = code((b - luma) / 1.8556f + 0.5f);
+                planes[npixels * 2 + i] = code((r - luma) / 1.5748f + 0.5f);
+            }
+        });
+        to_little_endian(planes, npixels * 3);
+        if (!stream.header) {
+            header = "YUV4MPEG2 W" + int_to_str(spec.width) + " H" + int_to_str(spec.height)
+                   + " F" + int_to_str(fps) + ":1 Ip A1:1 C444p16 XCOLORRANGE=FULL\n";
+        }
+        header += "FRAME\n";
+    }
+    else {
+        print_error("unknown stream format: ", stream.format);
+        return false;
+    }
+    stream.header = true;
+    
+    if ((header.size() && fwrite(header.data(), 1, header.size(), stream.file) != header.size())
+        || fwrite(stream.buffer.data(), 1, stream.buffer.size(), stream.file) != stream.buffer.size()) {
+        print_error("could not write output stream: ", stream.path);
+        return false;
+    }
+    return true;
 }
 
-Imath::Vec3<float> mult_matrix(const Imath::Vec3<float>& src, const Imath::Matrix33<float>& matrix) {
-    return src * matrix.transposed(); // imath row-order from column-order convention
+// encode
+struct Encoding
+{
+    std::string compression;
+    int tilewidth = 0;
+    int tileheight = 0;
+};
+
+void apply_encoding(ImageBuf& imageBuf, const Encoding& encoding)
+{
+    if (encoding.compression.size()) {
+        imageBuf.specmod().attribute("compression", encoding.compression);
+    }
+    if (encoding.tilewidth > 0) {
+        imageBuf.set_write_tiles(encoding.tilewidth, encoding.tileheight);
+    }
 }
 
-// Color space and conversions, with support for illuminants and white point adaptation.
-// https://github.com/mikaelsundell/colortool
-Imath::Vec3<float> lab_to_d50(const Imath::Vec3<float>& src) {
-    const double Xn = 0.9642;
-    const double Yn = 1.00000;
-    const double Zn = 0.8251;
-    double fy = (src.x + 16.0) / 116.0;
-    double fx = fy + (src.y / 500.0);
-    double fz = fy - (src.z / 200.0);
-    double fx3 = std::pow(fx, 3.0);
-    double fz3 = std::pow(fz, 3.0);
-    float X = (fx3 > 0.008856) ? fx3 : ((fx - 16.0 / 116.0) / 7.787);
-    float Y = (src.x > 8.0) ? std::pow(((src.x + 16.0) / 116.0), 3.0) : (src.x / 903.3);
-    float Z = (fz3 > 0.008856) ? fz3 : ((fz - 16.0 / 116.0) / 7.787);
-    X *= Xn;
-    Y *= Yn;
-    Z *= Zn;
-    return Imath::Vec3<float>(X, Y, Z);
+void encode_report(const ImageBuf& imageBuf, const std::string& filename, const Encoding& encoding, const std::string& compressions)
+{
+    // each compression is encoded to a temporary file of the same format
+    print_info("encode report: ", filename);
+    const std::string extension = Filesystem::extension(filename);
+    for (const std::string& compression : Strutil::splits(compressions, ",")) {
+        ImageBuf reportBuf(imageBuf);
+        Encoding report = encoding;
+        report.compression = compression;
+        apply_encoding(reportBuf, report);
+        
+        const std::string tempfile = Filesystem::temp_directory_path() + "/" + Filesystem::unique_path() + extension;
+        auto start = std::chrono::steady_clock::now();
+        bool written = reportBuf.write(tempfile);
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        if (!written) {
+            print_warning("could not encode compression: " + compression + ": ", reportBuf.geterror());
+            continue;
+        }
+        const uint64_t size = Filesystem::file_size(tempfile);
+        std::string error;
+        Filesystem::remove(tempfile, error);
+        print_info(" " + compression + ": ", float_to_str(elapsed.count() / 1000.0f, 1) + " ms, "
+                   + float_to_str(size / (1024.0f * 1024.0f), 2) + " MB");
+    }
 }
 
-Imath::Vec3<float> d50_to_d65(const Imath::Vec3<float>& src) {
-    Imath::Matrix33<float> matrix(
-      0.9555766f, -0.0230393f, 0.0631636f,
-      -0.0282895f, 1.0099416f, 0.0210077f,
-      0.0122982f, -0.020483f, 1.3299098f);
-    return mult_matrix(src, matrix);
+// writer, bounded queue of rendered images encoded in the background
+struct WriteJob
+{
+    OutputImage image;
+    std::string filename;
+};
+
+struct ImageWriter
+{
+    size_t capacity = 1;
+    std::queue<WriteJob> jobs;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable space;
+    std::vector<std::thread> threads;
+    bool closed = false;
+    std::vector<std::string> written;
+    int failed = 0;
+};
+
+int writer_threads(const LogCTool& tool, const std::vector<Output>& outputs)
+{
+    // encoders share cores with rendering and codec threads, each file output encodes concurrently
+    const int nthreads = tool.threads > 0 ? tool.threads : (int)Sysutil::hardware_concurrency();
+    int nfiles = 0;
+    for (const Output& output : outputs) {
+        if (output.filename.size()) {
+            nfiles++;
+        }
+    }
+    return std::max(1, std::min(nthreads, std::max(nfiles, nthreads / 4)));
 }
 
-// logc3 colorspace
-struct LogC3Colorspace
+void start_writer(ImageWriter& writer, int nthreads)
 {
-    int ei;
-    float cut;
-    float a;
-    float b;
-    float c;
-    float d;
-    float e;
-    float f;
-    float lin2log(float lin)
-    {
-        return ((lin > cut) ? c * log10(a * lin + b) + d : e * lin + f);
+    writer.capacity = 2 * nthreads;
+    const TraceJob tracejob = trace_job();
+    for (int t = 0; t < nthreads; t++) {
+        writer.threads.emplace_back([&writer, tracejob]() {
+            trace_thread("writer");
+            trace_job(tracejob);
+            for (;;) {
+                WriteJob job;
+                {
+                    std::unique_lock<std::mutex> lock(writer.mutex);
+                    writer.ready.wait(lock, [&]() { return writer.closed || !writer.jobs.empty(); });
+                    if (writer.jobs.empty()) {
+                        return;
+                    }
+                    job = std::move(writer.jobs.front());
+                    writer.jobs.pop();
+                }
+                writer.space.notify_one();
+                bool written;
+                {
+                    // oiio encodes while writing
+                    TraceSpan span("encode and write", "io", job.filename);
+                    written = write_image(job.image.imageBuf, job.filename);
+                }
+                std::lock_guard<std::mutex> lock(writer.mutex);
+                if (written) {
+                    writer.written.push_back(job.filename);
+                } else {
+                    writer.failed++;
+                }
+            }
+        });
     }
-    float log2lin(float log)
+}
+
+void queue_write(ImageWriter& writer, OutputImage&& image, const std::string& filename)
+{
+    // blocks the renderer while the queue is full, bounds memory
     {
-        return ((log > e * cut + f) ? (pow(10, (log - d) / c) - b) / a : (log - f) / e);
+        TraceSpan span("queue wait", "io", filename);
+        std::unique_lock<std::mutex> lock(writer.mutex);
+        writer.space.wait(lock, [&]() { return writer.jobs.size() < writer.capacity; });
+        writer.jobs.push(WriteJob { std::move(image), filename });
     }
-    Imath::Vec3<float> xyz_from_awg3(Imath::Vec3<float> color)
+    writer.ready.notify_one();
+}
+
+int finish_writer(ImageWriter& writer)
+{
     {
-        Imath::Matrix33<float> matrix(
-            1.789066f, -0.482534f, -0.200076f,
-            -0.639849f, 1.396400f, 0.194432f,
-            -0.041532f, 0.082335f, 0.878868f);
-        return mult_matrix(color, matrix);
+        std::lock_guard<std::mutex> lock(writer.mutex);
+        writer.closed = true;
     }
-    Imath::Vec3<float> awg3_from_xyz(Imath::Vec3<float> color)
-    {
-        Imath::Matrix33<float> matrix(
-            0.638008f, 0.214704f, 0.097744f,
-            0.291954f, 0.823841f, -0.115795f,
-            0.002798f, -0.067034f, 1.153294f);
-        return mult_matrix(color, matrix);
+    writer.ready.notify_all();
+    for (std::thread& thread : writer.threads) {
+        thread.join();
     }
-};
+    writer.threads.clear();
+    return writer.failed;
+}
 
-// lut transform
-struct LutTransform
+bool writer_written(const ImageWriter& writer, const std::string& filename)
 {
-    std::string description;
-    std::string filename;
-};
+    return std::find(writer.written.begin(), writer.written.end(), filename) != writer.written.end();
+}
 
-// patch
-struct Patch
+// cache
+struct CacheIndex
 {
-    int no;
-    std::string name;
-    float cieLabd50_l;
-    float cieLabd50_a;
-    float cieLabd50_b;
-    // optional
-    float sRGB_r;
-    float sRGB_g;
-    float sRGB_b;
-    float munsell_hue;
-    float munsell_value;
-    float munsell_chroma;
+    std::string filename;
+    std::map<std::string, std::string> hashes;
 };
 
-std::vector<Patch> load_patches(const std::string& jsonfile)
+bool load_cache_index(CacheIndex& index, const std::string& filename)
 {
-    std::vector<Patch> patches;
-    std::ifstream json(jsonfile);
-    if (!json.is_open()) {
-        print_error("could not open colorpatches file: ", jsonfile);
-        return patches;
+    index.filename = filename;
+    if (!Filesystem::exists(filename)) {
+        return true;
     }
     ptree pt;
-    read_json(jsonfile, pt);
+    try {
+        read_json(filename, pt);
+    } catch (const json_parser_error& e) {
+        print_warning("could not read cache index, outputs are rendered: ", e.what());
+        return false;
+    }
     for (const auto& item : pt) {
-        const ptree& data = item.second;
-        Patch patch;
-        patch.name = data.get<std::string>("name", "");
-        patch.cieLabd50_l = data.get<float>("CIE L*a*b*.L*", 0.0f);
-        patch.cieLabd50_a = data.get<float>("CIE L*a*b*.a*", 0.0f);
-        patch.cieLabd50_b = data.get<float>("CIE L*a*b*.b*", 0.0f);
-        // optional
-        patch.sRGB_r = data.get<float>("sRGB.R", 0.0f);
-        patch.sRGB_g = data.get<float>("sRGB.G", 0.0f);
-        patch.sRGB_b = data.get<float>("sRGB.B", 0.0f);
-        std::string munsell_hue = data.get<std::string>("Munsell Notation.Hue", "");
-        patch.munsell_hue = 0.0f;
-        if (!munsell_hue.empty()) {
-            size_t space_pos = munsell_hue.find(' ');
-            if (space_pos != std::string::npos) {
-                std::string hue_numeric = munsell_hue.substr(0, space_pos);
-                try {
-                    patch.munsell_hue = std::stof(hue_numeric);
-                } catch (...) {
-                    patch.munsell_hue = 0.0f;
-                }
-            }
-        }
-        patch.munsell_value = data.get<float>("Munsell Notation.Value", 0.0f);
-        patch.munsell_chroma = data.get<float>("Munsell Notation.Chroma", 0.0f);
-        patches.push_back(patch);
+        index.hashes[item.second.get<std::string>("filename", "")] = item.second.get<std::string>("hash", "");
     }
-    return patches;
+    return true;
 }
 
-void render_patches(
-    ImageBuf& imageBuf,
-    const std::vector<Patch>& patches,
-    int patchrows,
-    int patchcols,
-    int patchwidth,
-    int patchheight,
-    int spacing,
-    float sizecode,
-    float sizelabel,
-    LogC3Colorspace& colorspace,
-    const TypeDesc& typedesc,
-    bool is10bit,
-    float typelimit,
-    bool outputlinear,
-    const ConstCPUProcessorRcPtr& transformProcessor,
-    bool outputnolabels,
-    bool row_order
-) {
-    const int width = imageBuf.spec().width;
-    const int height = imageBuf.spec().height;
-    const int channels = imageBuf.nchannels();
-
-    const std::string fontfile = font_path("Roboto.ttf");
-    const float fontcolor[4] = {1,1,1,1};
-
-    for (int row = 0; row < patchrows; ++row) {
-        for (int col = 0; col < patchcols; ++col) {
-            const int no = row_order ? (row * patchcols + col)
-                                     : (col * patchrows + row);
-
-            const auto& patch = patches[no];
-
-            Imath::Vec3<float> xyz =
-                d50_to_d65(lab_to_d50(Imath::Vec3<float>(
-                    patch.cieLabd50_l, patch.cieLabd50_a, patch.cieLabd50_b)));
-
-            Imath::Vec3<float> awg = colorspace.xyz_from_awg3(xyz);
-            Imath::Vec3<float> out =
-                outputlinear
-                    ? awg
-                    : Imath::Vec3<float>(colorspace.lin2log(awg.x),
-                                         colorspace.lin2log(awg.y),
-                                         colorspace.lin2log(awg.z));
-
-            if (transformProcessor) {
-                float rgb[3] = { out.x, out.y, out.z };
-                transformProcessor->applyRGB(rgb);
-                out.setValue(rgb[0], rgb[1], rgb[2]);
-            }
-
-            const int x0 = col * (patchwidth + spacing) + spacing;
-            const int y0 = row * (patchheight + spacing) + spacing;
-            const int x1 = x0 + patchwidth;
-            const int y1 = y0 + patchheight;
-
-            ImageBufAlgo::fill(
-                imageBuf,
-                { out.x, out.y, out.z },
-                ROI(x0, x1, y0, y1, 0, 1, 0, std::min(3, channels)));
-
-            if (!outputnolabels) {
-                std::string code;
-                if (typedesc.is_floating_point()) {
-                    code = float_to_str(out.x) + ", "
-                         + float_to_str(out.y) + ", "
-                         + float_to_str(out.z);
-                } else {
-                    auto q = [&](float f)->int {
-                        f = std::max(0.0f, std::min(1.0f, f));
-                        return (int)std::lround(f * typelimit);
-                    };
-                    int xi = q(out.x), yi = q(out.y), zi = q(out.z);
-                    if (is10bit) {
-                        code = _10bit_to_str(xi) + ", "
-                             + _10bit_to_str(yi) + ", "
-                             + _10bit_to_str(zi);
-                    } else {
-                        code = int_to_str(xi) + ", "
-                             + int_to_str(yi) + ", "
-                             + int_to_str(zi);
-                    }
-                }
+bool save_cache_index(const CacheIndex& index)
+{
+    ptree pt;
+    for (const auto& entry : index.hashes) {
+        ptree item;
+        item.put("filename", entry.first);
+        item.put("hash", entry.second);
+        pt.push_back(std::make_pair("", item));
+    }
+    return write_sidecar(index.filename, pt);
+}
 
-                const int cx = x0 + patchwidth/2;
-                const int ty = y0;
+std::string cache_key(
+    const LogCTool& tool,
+    const LogC3Colorspace& colorspace,
+    float midgray,
+    Resources& resources,
+    bool image
+) {
+    std::vector<std::string> values {
+        LOGCTOOL_VERSION,
+        int_to_str(colorspace.ei),
+        float_to_str(colorspace.cut, 9),
+        float_to_str(colorspace.a, 9),
+        float_to_str(colorspace.b, 9),
+        float_to_str(colorspace.c, 9),
+        float_to_str(colorspace.d, 9),
+        float_to_str(colorspace.e, 9),
+        float_to_str(colorspace.f, 9),
+        float_to_str(midgray, 9),
+        tool.transform,
+        int_to_str(tool.transformbake),
+        tool.optimization
+    };
+    std::vector<std::string> files;
+    for (const std::string& item : Strutil::splits(tool.transform, ",")) {
+        std::string filename = transform_filename(resources, item);
+        if (filename.size()) {
+            files.push_back(filename);
+        }
+    }
+    // luts only depend on the curve and transform
+    if (image) {
+        values.insert(values.end(), {
+            tool.outputtype,
+            int_to_str(tool.width),
+            int_to_str(tool.height),
+            int_to_str(tool.channels),
+            tool.outputlinear ? "linear" : "log",
+            tool.outputnolabels ? "nolabels" : "labels",
+            tool.roi,
+            tool.strip,
+            tool.labelname,
+            tool.compression,
+            tool.tile,
+            int_to_str(tool.preview),
+            tool.previewfull ? "previewfull" : "",
+            tool.sweep
+        });
+        files.push_back(font_path("Roboto.ttf"));
+        PatchLayout layout;
+        if (tool.patchfile.size()) {
+            files.push_back(tool.patchfile);
+        } else if (patch_layout(tool.outputtype, tool.width, tool.height, layout)) {
+            files.push_back(layout.patchfile);
+        }
+    }
+    return content_hash(values, files);
+}
 
-                ImageBufAlgo::render_text(
-                    imageBuf, cx, ty + (int)std::round(patchheight * 0.50f),
-                    patch.name, sizecode, fontfile, fontcolor,
-                    ImageBufAlgo::TextAlignX::Center,
-                    ImageBufAlgo::TextAlignY::Center);
+bool cache_metadata(const std::string& filename)
+{
+    // formats that round-trip the hash, others need an index
+    const std::string extension = Strutil::lower(Filesystem::extension(filename));
+    return extension == ".exr" || extension == ".cube" || extension == ".clf" || extension == ".json";
+}
 
-                ImageBufAlgo::render_text(
-                    imageBuf, cx, ty + (int)std::round(patchheight * 0.9f),
-                    code, sizelabel, fontfile, fontcolor,
-                    ImageBufAlgo::TextAlignX::Center,
-                    ImageBufAlgo::TextAlignY::Center);
+bool cached_output(const std::string& filename, const std::string& hash, const CacheIndex& index)
+{
+    if (!Filesystem::exists(filename)) {
+        return false;
+    }
+    auto it = index.hashes.find(filename);
+    if (it != index.hashes.end() && it->second == hash) {
+        return true;
+    }
+    // hash is stored in the output itself
+    const std::string extension = Strutil::lower(Filesystem::extension(filename));
+    if (extension == ".cube") {
+        std::ifstream inputFile(filename);
+        std::string line;
+        while (std::getline(inputFile, line) && (line.empty() || line[0] == '#')) {
+            if (line == "#    Hash: " + hash) {
+                return true;
+            }
+        }
+        return false;
+    }
+    if (extension == ".clf") {
+        std::ifstream inputFile(filename);
+        std::string line;
+        while (std::getline(inputFile, line) && line.find("<Array") == std::string::npos) {
+            if (line == "    <Description>Hash: " + hash + "</Description>") {
+                return true;
             }
         }
+        return false;
+    }
+    if (extension == ".json") {
+        ptree pt;
+        try {
+            read_json(filename, pt);
+        } catch (const json_parser_error&) {
+            return false;
+        }
+        return pt.get<std::string>("logctool.hash", "") == hash;
     }
+    std::unique_ptr<ImageInput> input = ImageInput::open(filename);
+    return input && input->spec().get_string_attribute("logctool:hash") == hash;
 }
 
-static void render_reference_patches(
-    OIIO::ImageBuf& imageBuf,
-    const std::vector<Patch>& patches,
-    int referencex,
-    int referenceheight,
-    int spacing,
-    float sizecode,
-    float sizelabel,
+// cube luts
+int write_cube_luts(
+    const LogCTool& tool,
     LogC3Colorspace& colorspace,
-    const OIIO::TypeDesc& typedesc,
-    bool is10bit,
-    float typelimit,
-    bool outputlinear,
-    const OpenColorIO_v2_3::ConstCPUProcessorRcPtr& transformProcessor,
-    bool outputnolabels,
-    int white_index,
-    int black_index
+    float midgray,
+    const ConstCPUProcessorRcPtr& transformProcessor,
+    const std::string& cachekey,
+    CacheIndex& cacheindex,
+    std::vector<std::string>* files
 ) {
-    const int width = imageBuf.spec().width;
-    const int height = imageBuf.spec().height;
-    const int nch = imageBuf.nchannels();
-
-    const int indices[2] = { white_index, black_index };
-    const std::string fontfile = font_path("Roboto.ttf");
-    const float fontcolor[4] = { 1, 1, 1, 1 };
-
-    for (int i = 0; i < 2; ++i) {
-        const auto& patch = patches[ indices[i] ];
-
-        Imath::Vec3<float> xyz =
-            d50_to_d65(lab_to_d50(Imath::Vec3<float>(
-                patch.cieLabd50_l, patch.cieLabd50_a, patch.cieLabd50_b)));
-
-        Imath::Vec3<float> awg = colorspace.xyz_from_awg3(xyz);
-        Imath::Vec3<float> out = outputlinear
-            ? awg
-            : Imath::Vec3<float>(colorspace.lin2log(awg.x),
-                                 colorspace.lin2log(awg.y),
-                                 colorspace.lin2log(awg.z));
-
-        if (transformProcessor) {
-            float rgb[3] = { out.x, out.y, out.z };
-            transformProcessor->applyRGB(rgb);
-            out.setValue(rgb[0], rgb[1], rgb[2]);
-        }
-
-        const int x0 = referencex;
-        const int x1 = width - spacing;
-        const int y0 = i * (referenceheight + spacing) + spacing;
-        const int y1 = y0 + referenceheight - 1;
-
-        ImageBufAlgo::fill(
-            imageBuf,
-            { out.x, out.y, out.z },
-            OIIO::ROI(x0, x1, y0, y1, 0, 1, 0, std::min(3, nch)));
-
-        if (!outputnolabels) {
-            std::string code;
-            if (typedesc.is_floating_point()) {
-                code = float_to_str(out.x) + ", " +
-                       float_to_str(out.y) + ", " +
-                       float_to_str(out.z);
-            } else {
-                auto q = [&](float f)->int {
-                    f = std::max(0.0f, std::min(1.0f, f));
-                    return (int)std::lround(f * typelimit);
-                };
-                int xi = q(out.x), yi = q(out.y), zi = q(out.z);
-                if (is10bit) {
-                    code = _10bit_to_str(xi) + ", " +
-                           _10bit_to_str(yi) + ", " +
-                           _10bit_to_str(zi);
-                } else {
-                    code = int_to_str(xi) + ", " +
-                           int_to_str(yi) + ", " +
-                           int_to_str(zi);
+    auto write_lut = [&](const std::string& filename, const std::string& type, const std::string& name, int size) {
+        // false color and stops are luma only, optionally written as 1d luts
+        const std::string extension = Strutil::lower(Filesystem::extension(filename));
+        if (extension != ".cube" && (extension != ".clf" || type == "inverse")) {
+            print_error("unsupported " + name + " lut extension, expected " + (type == "inverse" ? ".cube" : ".cube or .clf") + ": ", filename);
+            return false;
+        }
+        bool luma = false;
+        if (type != "inverse" && (tool.lumalutsize > 0 || extension == ".clf")) {
+            luma = true;
+            size = tool.lumalutsize > 0 ? tool.lumalutsize : 4096;
+        }
+        if (luma && size < 2) {
+            print_error("luma lut size must be at least 2: ", size);
+            return false;
+        }
+        std::string hash;
+        if (cachekey.size()) {
+            hash = content_hash({ cachekey, type, int_to_str(size), luma ? "luma" : "cube" }, {});
+            if (cached_output(filename, hash, cacheindex)) {
+                print_info("cached output " + name + " cube (lut) file: ", filename);
+                if (files) {
+                    files->push_back(filename);
                 }
+                return true;
             }
-
-            const int cx = referencex + ((width - referencex - spacing) / 2);
-
-            ImageBufAlgo::render_text(
-                imageBuf, cx, y0 + (int)std::round(referenceheight * 0.48f),
-                patch.name, sizecode, fontfile, fontcolor,
-                ImageBufAlgo::TextAlignX::Center, ImageBufAlgo::TextAlignY::Center);
-
-            ImageBufAlgo::render_text(
-                imageBuf, cx, y0 + (int)std::round(referenceheight * 0.55f),
-                code, sizelabel, fontfile, fontcolor,
-                ImageBufAlgo::TextAlignX::Center, ImageBufAlgo::TextAlignY::Center);
         }
+        print_info("writing output " + name + " cube (lut) file: ", filename);
+        TraceSpan span("lut", "lut", filename);
+        
+        std::vector<float> values;
+        if (type == "inverse") {
+            InverseError error;
+            values = inverse_lut_values(size, transformProcessor, error);
+            print_info("inverse round trip max error: ", float_to_str(error.max, 6));
+            print_info("inverse round trip mean error: ", float_to_str(error.mean, 6));
+            if (error.unreachable) {
+                print_warning("inverse lattice points outside of the transform range: ", error.unreachable);
+            }
+        } else if (luma) {
+            values = luma_lut_values(type, size, colorspace, midgray, transformProcessor);
+        } else {
+            values = cube_lut_values(type, size, colorspace, midgray, transformProcessor);
+        }
+        bool written = luma
+            ? write_luma_lut(filename, type, values, size, tool.ei, tool.transform, hash)
+            : write_cube_lut(filename, type, values, size, tool.ei, tool.transform, hash);
+        if (!written) {
+            print_error("could not open output " + name + " cube (lut) file: ", filename);
+            return false;
+        }
+        if (hash.size()) {
+            cacheindex.hashes[filename] = hash;
+        }
+        if (files) {
+            files->push_back(filename);
+        }
+        return true;
+    };
+    int code = EXIT_SUCCESS;
+    
+    // output false color cube (LUT) file
+    if (tool.outputfalsecolorcubefile.length()) {
+        if (!write_lut(tool.outputfalsecolorcubefile, "falsecolor", "false color", 32 + 1)) {
+            code = EXIT_FAILURE;
+        }
+    }
+    
+    // output stops cube (LUT) file
+    if (tool.outputstopscubefile.length()) {
+        if (!write_lut(tool.outputstopscubefile, "stops", "stops", 32 + 1)) {
+            code = EXIT_FAILURE;
+        }
+    }
+    
+    // output inverse cube (LUT) file
+    if (tool.outputinversecubefile.length()) {
+        if (!transformProcessor) {
+            print_error("inverse cube (lut) file needs a transform: ", tool.outputinversecubefile);
+            code = EXIT_FAILURE;
+        } else if (tool.inversecubesize < 2) {
+            print_error("inverse cube (lut) size must be at least 2: ", tool.inversecubesize);
+            code = EXIT_FAILURE;
+        } else if (!write_lut(tool.outputinversecubefile, "inverse", "inverse", tool.inversecubesize)) {
+            code = EXIT_FAILURE;
+        }
+    }
+    return code;
+}
+
+// sweep
+std::string frame_filename(const std::string& filename, int frame)
+{
+    // #### is replaced by the zero padded frame, else the frame goes before the extension
+    std::ostringstream oss;
+    size_t end = filename.find_last_of('#');
+    if (end != std::string::npos) {
+        size_t begin = end;
+        while (begin > 0 && filename[begin - 1] == '#') {
+            begin--;
+        }
+        oss << std::setw(end - begin + 1) << std::setfill('0') << frame;
+        return filename.substr(0, begin) + oss.str() + filename.substr(end + 1);
+    }
+    size_t pos = filename.size() - Filesystem::extension(filename).size();
+    oss << "." << std::setw(4) << std::setfill('0') << frame;
+    return filename.substr(0, pos) + oss.str() + filename.substr(pos);
+}
+
+int run_sweep(
+    const LogCTool& tool,
+    const Chart& base,
+    const std::vector<Output>& outputs,
+    const Encoding& encoding,
+    std::vector<std::string>* files
+) {
+    float start, end, step;
+    if (sscanf(tool.sweep.c_str(), "%f,%f,%f", &start, &end, &step) != 3
+        || step == 0.0f || (end - start) / step < 0.0f) {
+        print_error("could not parse sweep, expected start,end,step in stops: ", tool.sweep);
+        return EXIT_FAILURE;
+    }
+    const int frames = (int)std::floor((end - start) / step + 0.5f) + 1;
+    print_info("sweep frames: ", frames);
+    
+    std::vector<FrameStream> streams(outputs.size());
+    for (size_t i = 0; i < outputs.size(); i++) {
+        if (outputs[i].shm.size()) {
+            print_error("shared memory output is not supported for sweep: ", outputs[i].shm);
+            return EXIT_FAILURE;
+        }
+        if (outputs[i].stream.size() && !open_stream(streams[i], outputs[i].stream, tool.streamformat)) {
+            return EXIT_FAILURE;
+        }
+    }
+    
+    // labels are rendered once, only values change per frame
+    ImageBuf overlayBuf;
+    if (!base.outputnolabels) {
+        render_overlay(base, overlayBuf);
+    }
+    
+    // streams are written in frame order, frames finish in any order
+    std::mutex mutex;
+    std::map<int, std::vector<OutputImage>> pending;
+    int nextframe = 0;
+    std::atomic<bool> failed(false);
+    
+    // files are encoded while the next frames render
+    ImageWriter writer;
+    start_writer(writer, writer_threads(tool, outputs));
+    
+    auto render_frame = [&](int frame) {
+        Chart chart = base;
+        chart.exposure = start + frame * step;
+        render_chart_values(chart);
+        if (!chart.outputnolabels) {
+            composite_overlay(chart.masterBuf, overlayBuf);
+        }
+        if (tool.verbose) {
+            print_info("rendered frame: ", int_to_str(frame) + " exposure: " + float_to_str(chart.exposure));
+        }
+        
+        std::vector<OutputImage> streamImages(outputs.size());
+        for (size_t i = 0; i < outputs.size(); i++) {
+            const Output& output = outputs[i];
+            std::string filename = output.filename.size() ? frame_filename(output.filename, frame) : "";
+            std::string labelname = tool.labelname.size() ? frame_filename(tool.labelname, frame) : filename;
+            OutputImage image;
+            if (!render_output_image(image, chart, output.format, labelname)) {
+                print_error("could not quantize image: ", image.imageBuf.geterror());
+                failed = true;
+                continue;
+            }
+            if (output.stream.size()) {
+                streamImages[i] = std::move(image);
+            } else {
+                apply_encoding(image.imageBuf, encoding);
+                queue_write(writer, std::move(image), filename);
+            }
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        pending[frame] = std::move(streamImages);
+        while (pending.count(nextframe)) {
+            std::vector<OutputImage>& images = pending[nextframe];
+            for (size_t i = 0; i < outputs.size(); i++) {
+                if (outputs[i].stream.size() && !write_stream(streams[i], images[i].imageBuf, tool.streamfps)) {
+                    failed = true;
+                }
+            }
+            pending.erase(nextframe++);
+        }
+    };
+    
+    // frame-level parallelism, one frame per worker
+    std::atomic<int> next(0);
+    std::vector<std::thread> workers;
+    const int nworkers = std::min(frames, tool.threads > 0 ? tool.threads : (int)std::max(1u, Sysutil::hardware_concurrency()));
+    const TraceJob tracejob = trace_job();
+    for (int t = 0; t < nworkers; t++) {
+        workers.emplace_back([&]() {
+            trace_thread("frame");
+            trace_job(tracejob);
+            for (int frame = next++; frame < frames; frame = next++) {
+                TraceSpan span("frame", "job", int_to_str(frame));
+                render_frame(frame);
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (FrameStream& stream : streams) {
+        close_stream(stream);
+    }
+    if (finish_writer(writer)) {
+        failed = true;
+    }
+    if (files) {
+        files->insert(files->end(), writer.written.begin(), writer.written.end());
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// preview
+std::string preview_filename(const std::string& filename)
+{
+    size_t pos = filename.size() - Filesystem::extension(filename).size();
+    return filename.substr(0, pos) + ".preview" + filename.substr(pos);
+}
+
+int write_previews(
+    const LogCTool& tool,
+    Chart chart,
+    const std::vector<Output>& outputs,
+    Resources& resources,
+    std::vector<std::string>* files
+) {
+    auto start = std::chrono::steady_clock::now();
+    
+    // same code paths at reduced resolution, region scaled with the chart
+    const int scale = tool.preview;
+    const int width = std::max(1, tool.width / scale);
+    const int height = std::max(1, tool.height / scale);
+    if (chart.roi.defined()) {
+        chart.roi = ROI(chart.roi.xbegin / scale, std::max(chart.roi.xbegin / scale + 1, chart.roi.xend / scale),
+                        chart.roi.ybegin / scale, std::max(chart.roi.ybegin / scale + 1, chart.roi.yend / scale));
+    }
+    std::string error;
+    if (!render_chart(chart, width, height, tool.channels, resources, error)) {
+        print_error(error);
+        return EXIT_FAILURE;
+    }
+    int code = EXIT_SUCCESS;
+    for (const Output& output : outputs) {
+        if (output.filename.empty()) {
+            continue;
+        }
+        const std::string filename = preview_filename(output.filename);
+        ImageBuf imageBuf;
+        if (!render_output(imageBuf, chart, output.format, filename)) {
+            print_error("could not quantize image: ", imageBuf.geterror());
+            code = EXIT_FAILURE;
+            continue;
+        }
+        if (!write_image(imageBuf, filename)) {
+            code = EXIT_FAILURE;
+        } else if (files) {
+            files->push_back(filename);
+        }
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    print_info("preview time (ms): ", (long long)elapsed.count());
+    return code;
+}
+
+// run
+int run(LogCTool tool, Resources& resources, std::vector<std::string>* files = nullptr)
+{
+    // trace
+    static std::atomic<int> jobs(0);
+    const int jobno = ++jobs;
+    trace_job({ tool.jobid.size() ? tool.jobid : int_to_str(jobno), tool.outputtype });
+    TraceSpan span("job", "job");
+    
+    // logc midgray
+    float midgray = 0.18f;
+    
+    // logc colorspace
+    LogC3Colorspace colorspace;
+    logc3_colorspace(tool.ei, colorspace);
+    
+    // image data
+    print_info("image data");
+    if (colorspace.ei > 0) {
+        print_info("ei: ", colorspace.ei);
+        if (tool.verbose) {
+            print_info("cut: ", colorspace.cut);
+            print_info("a: ", colorspace.a);
+            print_info("b: ", colorspace.b);
+            print_info("c: ", colorspace.c);
+            print_info("d: ", colorspace.d);
+            print_info("e: ", colorspace.e);
+            print_info("f: ", colorspace.f);
+        }
+    }
+    else {
+        print_error("unknown ei: ", tool.ei);
+        return EXIT_FAILURE;
+    }
+    
+    // image format
+    DataFormat format;
+    if (!data_format(tool.dataformat, format)) {
+        print_error("unknown data format: ", tool.dataformat);
+        return EXIT_FAILURE;
+    }
+    
+    // ocio optimization
+    OptimizationFlags optimization;
+    if (!ocio_optimization(tool.optimization, optimization)) {
+        print_error("unknown optimization: ", tool.optimization);
+        return EXIT_FAILURE;
+    }
+    
+    // outputs
+    std::vector<Output> outputs;
+    if (tool.outputfilename.size()) {
+        Output output;
+        output.filename = tool.outputfilename;
+        output.format = format;
+        outputs.push_back(output);
+    }
+    if (tool.outputshm.size()) {
+        Output output;
+        output.format = format;
+        output.shm = tool.outputshm;
+        outputs.push_back(output);
+    }
+    if (tool.outputstream.size()) {
+        Output output;
+        output.stream = tool.outputstream;
+        if (!stream_format(tool.streamformat, output.format)) {
+            print_error("unknown stream format: ", tool.streamformat);
+            return EXIT_FAILURE;
+        }
+        outputs.push_back(output);
+    }
+    for (const std::string& outputs_arg : tool.outputs) {
+        for (const std::string& item : Strutil::splits(outputs_arg, ",")) {
+            Output output;
+            output.filename = item;
+            output.format = format;
+            size_t pos = item.rfind(':');
+            if (pos != std::string::npos && pos > 1) { // allow drive letters
+                output.filename = item.substr(0, pos);
+                if (!data_format(item.substr(pos + 1), output.format)) {
+                    print_error("unknown data format: ", item.substr(pos + 1));
+                    return EXIT_FAILURE;
+                }
+            }
+            outputs.push_back(output);
+        }
+    }
+    
+    // characterize
+    if (tool.characterize.size()) {
+        ConstCPUProcessorRcPtr processor = transform_processor(resources, tool.characterize, tool.transformbake, optimization);
+        if (!processor) {
+            print_error("unknown transform: ", tool.characterize);
+            return EXIT_FAILURE;
+        }
+        return characterize_transform(tool.characterize,
+                                      tool.characterizefile,
+                                      colorspace,
+                                      midgray,
+                                      format,
+                                      processor);
+    }
+    
+    // lut file, applied after the named transforms
+    if (tool.lutfile.size()) {
+        if (!Filesystem::is_regular(tool.lutfile)) {
+            print_error("could not open lut file: ", tool.lutfile);
+            return EXIT_FAILURE;
+        }
+        tool.transform = tool.transform.size() ? tool.transform + "," + tool.lutfile : tool.lutfile;
+    }
+    
+    // patch file
+    if (tool.patchfile.size()) {
+        if (!Filesystem::is_regular(tool.patchfile)) {
+            print_error("could not open patch file: ", tool.patchfile);
+            return EXIT_FAILURE;
+        }
+        if (tool.outputtype == "stepchart") {
+            print_warning("patch file is not used for stepchart: ", tool.patchfile);
+        }
+    }
+    
+    // lut info
+    ConstCPUProcessorRcPtr transformProcessor;
+    
+    if (tool.transform.size()) {
+        if (tool.transformbake == 1 || tool.transformbake < 0) {
+            print_error("transform bake size must be at least 2: ", tool.transformbake);
+            return EXIT_FAILURE;
+        }
+        transformProcessor = transform_processor(resources, tool.transform, tool.transformbake, optimization);
+        if (!transformProcessor) {
+            print_error("unknown transform: ", tool.transform);
+            return EXIT_FAILURE;
+        }
+    }
+    
+    // verify
+    if (tool.verifyfilename.size()) {
+        return verify_chart(tool.verifyfilename,
+                            tool.outputtype,
+                            tool.patchfile,
+                            resources,
+                            colorspace,
+                            midgray,
+                            format,
+                            tool.outputlinear,
+                            transformProcessor,
+                            tool.verifytolerance);
+    }
+    
+    // cache, outputs with a matching hash are skipped
+    const std::string primaryfilename = outputs.size() ? outputs[0].filename : std::string();
+    CacheIndex cacheindex;
+    std::string cachekey;
+    std::string lutcachekey;
+    std::string sidecarhash;
+    if (tool.cache || tool.cacheindex.size()) {
+        std::string indexfilename = tool.cacheindex;
+        if (indexfilename.empty()) {
+            // outputs without metadata fall back to an index next to them
+            std::vector<std::string> filenames { tool.outputfalsecolorcubefile, tool.outputstopscubefile, tool.outputinversecubefile };
+            for (const Output& output : outputs) {
+                filenames.push_back(output.filename);
+            }
+            for (const std::string& filename : filenames) {
+                if (filename.size() && !cache_metadata(filename)) {
+                    std::string directory = Filesystem::parent_path(filename);
+                    indexfilename = (directory.size() ? directory + "/" : std::string()) + "logctool_cache.json";
+                    print_info("cache index for outputs without metadata: ", indexfilename);
+                    break;
+                }
+            }
+        }
+        if (indexfilename.size()) {
+            load_cache_index(cacheindex, indexfilename);
+        }
+        cachekey = cache_key(tool, colorspace, midgray, resources, true);
+        lutcachekey = cache_key(tool, colorspace, midgray, resources, false);
+    }
+    if (cachekey.size() && tool.sweep.empty()) {
+        std::vector<Output> uncached;
+        for (Output& output : outputs) {
+            if (output.filename.size()) {
+                // footer label includes the filename
+                output.hash = content_hash({ cachekey, output.format.name, output.filename }, {});
+                if (cached_output(output.filename, output.hash, cacheindex)) {
+                    print_info("cached output file: ", output.filename);
+                    if (files) {
+                        files->push_back(output.filename);
+                    }
+                    continue;
+                }
+            }
+            uncached.push_back(output);
+        }
+        bool sidecarcached = true;
+        if (tool.sidecarfilename.size()) {
+            sidecarhash = content_hash({ cachekey, format.name, tool.sidecarfilename, primaryfilename }, {});
+            sidecarcached = cached_output(tool.sidecarfilename, sidecarhash, cacheindex);
+            if (sidecarcached) {
+                print_info("cached output sidecar (json) file: ", tool.sidecarfilename);
+                if (files) {
+                    files->push_back(tool.sidecarfilename);
+                }
+            }
+        }
+        outputs = uncached;
+        if (outputs.empty() && sidecarcached) {
+            if (write_cube_luts(tool, colorspace, midgray, transformProcessor, lutcachekey, cacheindex, files) != EXIT_SUCCESS) {
+                tool.code = EXIT_FAILURE;
+            }
+            if (cacheindex.filename.size()) {
+                save_cache_index(cacheindex);
+            }
+            return tool.code;
+        }
+        if (sidecarcached) {
+            tool.sidecarfilename.clear();
+        }
+    }
+    
+    for (const Output& output : outputs) {
+        print_info("filename: ", output.filename);
+        print_info("format: ", output.format.typedesc);
+        if (output.format.is10bit) {
+            print_info(" 10bit: ", "yes");
+        }
+    }
+    
+    // transform
+    if (!tool.transform.empty()) {
+        print_info("transform: ", tool.transform);
+        if (tool.transformbake > 0) {
+            print_info("transform bake: ", tool.transformbake);
+        }
+    }
+    if (tool.optimization != "default") {
+        print_info("optimization: ", tool.optimization);
+    }
+    
+    // image data
+    int width = tool.width;
+    int height = tool.height;
+    int channels = tool.channels;
+    
+    if (tool.verbose) {
+        print_info(" width: ", width);
+        print_info(" height: ", height);
+        print_info(" channels: ", channels);
+    }
+    
+    if (tool.verbose) {
+        print_info(" typesize: ", format.typedesc.size());
+        print_info(" typelimit: ", format.typelimit);
+    }
+    
+    // region
+    ROI roi;
+    if (tool.roi.size()) {
+        int x0, x1, y0, y1;
+        if (sscanf(tool.roi.c_str(), "%d,%d,%d,%d", &x0, &x1, &y0, &y1) != 4 || x1 <= x0 || y1 <= y0) {
+            print_error("could not parse roi, expected x0,x1,y0,y1: ", tool.roi);
+            return EXIT_FAILURE;
+        }
+        roi = ROI(x0, x1, y0, y1);
+    }
+    else if (tool.strip.size()) {
+        int strip, strips;
+        if (sscanf(tool.strip.c_str(), "%d/%d", &strip, &strips) != 2 || !strip_roi(width, height, strip, strips, roi)) {
+            print_error("could not parse strip, expected i/N: ", tool.strip);
+            return EXIT_FAILURE;
+        }
+        if (tool.labelname.empty() && !tool.outputnolabels) {
+            print_warning("strip label shows the strip filename, use --labelname with the merged filename: ", tool.strip);
+        }
+    }
+    if (roi.defined()) {
+        print_info("region: ", int_to_str(roi.xbegin) + "," + int_to_str(roi.xend) + ","
+                             + int_to_str(roi.ybegin) + "," + int_to_str(roi.yend));
+        for (const Output& output : outputs) {
+            if (output.filename.empty()) {
+                continue;
+            }
+            // strips keep their origin in the data window for merge
+            std::unique_ptr<ImageOutput> out = ImageOutput::create(output.filename);
+            if (!out || !out->supports("origin")) {
+                print_error("output format does not support a region origin, use exr or tif: ", output.filename);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    // encoding
+    Encoding encoding;
+    encoding.compression = tool.compression;
+    if (tool.tile.size()) {
+        if (sscanf(tool.tile.c_str(), "%dx%d", &encoding.tilewidth, &encoding.tileheight) != 2
+            || encoding.tilewidth <= 0 || encoding.tileheight <= 0) {
+            print_error("could not parse tile, expected WxH: ", tool.tile);
+            return EXIT_FAILURE;
+        }
+    }
+    if (tool.verbose) {
+        if (encoding.compression.size()) {
+            print_info(" compression: ", encoding.compression);
+        }
+        if (encoding.tilewidth > 0) {
+            print_info(" tile: ", int_to_str(encoding.tilewidth) + "x" + int_to_str(encoding.tileheight));
+        }
+    }
+    
+    // sidecar
+    ptree sidecar;
+    sidecar.put("logctool.datetime", datetime());
+    if (sidecarhash.size()) {
+        sidecar.put("logctool.hash", sidecarhash);
+    }
+    sidecar.put("filename", primaryfilename);
+    sidecar.put("outputtype", tool.outputtype);
+    sidecar.put("dataformat", format.name);
+    sidecar.put("format", format.typedesc.c_str());
+    sidecar.put("bitspersample", format.is10bit ? 10 : (int)(format.typedesc.size() * 8));
+    sidecar.put("width", width);
+    sidecar.put("height", height);
+    sidecar.put("channels", channels);
+    if (roi.defined()) {
+        sidecar.add_child("roi", sidecar_array(std::vector<int> { roi.xbegin, roi.xend, roi.ybegin, roi.yend }));
+    }
+    sidecar.put("outputlinear", tool.outputlinear);
+    sidecar.put("transform", tool.transform);
+    if (tool.transformbake > 0) {
+        sidecar.put("transformbake", tool.transformbake);
+    }
+    if (tool.optimization != "default") {
+        sidecar.put("optimization", tool.optimization);
+    }
+    if (tool.patchfile.size()) {
+        sidecar.put("patchfile", tool.patchfile);
+    }
+    sidecar.put("midgray", midgray);
+    sidecar.put("colorspace.name", "LogC3");
+    sidecar.put("colorspace.ei", colorspace.ei);
+    sidecar.put("colorspace.cut", colorspace.cut);
+    sidecar.put("colorspace.a", colorspace.a);
+    sidecar.put("colorspace.b", colorspace.b);
+    sidecar.put("colorspace.c", colorspace.c);
+    sidecar.put("colorspace.d", colorspace.d);
+    sidecar.put("colorspace.e", colorspace.e);
+    sidecar.put("colorspace.f", colorspace.f);
+    
+    // float master, quantized once per output
+    Chart chart;
+    chart.outputtype = tool.outputtype;
+    chart.colorspace = colorspace;
+    chart.midgray = midgray;
+    chart.transform = tool.transform;
+    chart.outputlinear = tool.outputlinear;
+    chart.outputnolabels = tool.outputnolabels;
+    chart.transformProcessor = transformProcessor;
+    chart.optimization = optimization;
+    chart.patchfile = tool.patchfile;
+    chart.roi = roi;
+    
+    if (tool.outputtype == "stepchart") {
+        print_info("image: stepchart");
+    } else {
+        print_info("type: ", tool.outputtype);
+    }
+    
+    // preview, written before the full render
+    if (tool.preview > 1) {
+        if (tool.sweep.size()) {
+            print_warning("preview is not rendered for sweep: ", tool.sweep);
+        } else {
+            print_info("preview scale: ", "1/" + int_to_str(tool.preview));
+            int code = write_previews(tool, chart, outputs, resources, files);
+            if (!tool.previewfull || code != EXIT_SUCCESS) {
+                return code;
+            }
+        }
+    }
+    
+    std::string error;
+    if (tool.sweep.size()) {
+        if (!prepare_chart(chart, width, height, channels, resources, error)) {
+            print_error(error);
+            return EXIT_FAILURE;
+        }
+        if (tool.sidecarfilename.size()) {
+            print_warning("sidecar is not written for sweep: ", tool.sidecarfilename);
+        }
+        int code = run_sweep(tool, chart, outputs, encoding, files);
+        if (write_cube_luts(tool, colorspace, midgray, transformProcessor, lutcachekey, cacheindex, files) != EXIT_SUCCESS) {
+            code = EXIT_FAILURE;
+        }
+        if (cacheindex.filename.size()) {
+            save_cache_index(cacheindex);
+        }
+        return code;
+    }
+    if (!render_chart(chart, width, height, channels, resources, error)) {
+        print_error(error);
+        return EXIT_FAILURE;
+    }
+    
+    if (tool.outputtype == "stepchart") {
+        const std::vector<StepStop>& stops = chart.stops;
+        print_info("signal stops: ", stops.size());
+        ptree sidecarstops;
+        for (const StepStop& stop : stops) {
+            if (tool.verbose) {
+                print_info(" stop:  ", stop.stop);
+                print_info("   lin: ", stop.lin);
+                print_info("   log: ", stop.log);
+                if (tool.transform.size()) {
+                    print_info("   lut: ", stop.value);
+                }
+                print_info("   value: ", code_to_str(stop.value, format));
+            }
+            ptree sidecarstop;
+            sidecarstop.put("stop", stop.stop);
+            sidecarstop.put("lin", stop.lin);
+            sidecarstop.put("log", stop.log);
+            sidecarstop.put("value", stop.value);
+            if (format.typedesc.is_floating_point()) {
+                sidecarstop.put("percent", stop.value * 100.0f);
+            } else {
+                int code = value_to_code(stop.value, format);
+                if (format.is10bit) {
+                    sidecarstop.put("code", _10bit_to_int(code));
+                    sidecarstop.put("percent", 100.0f * _10bit_to_int(code) / (pow(2, 10) - 1));
+                } else {
+                    sidecarstop.put("code", code);
+                    sidecarstop.put("percent", 100.0f * code / format.typelimit);
+                }
+            }
+            sidecarstop.put("x", stop.x);
+            sidecarstops.push_back(std::make_pair("", sidecarstop));
+        }
+        sidecar.add_child("stops", sidecarstops);
+    }
+    else {
+        const PatchLayout& layout = chart.layout;
+        ptree sidecarpatches;
+        for (int row = 0; row < layout.patchrows; ++row) {
+            for (int col = 0; col < layout.patchcols; ++col) {
+                const int no = patch_index(layout, row, col);
+                if (no < 0) {
+                    continue;
+                }
+                ptree sidecarpatch = sidecar_patch(
+                    chart.patches[no], patch_roi(layout, row, col), chart.colors[no], format);
+                sidecarpatch.put("row", row);
+                sidecarpatch.put("col", col);
+                sidecarpatches.push_back(std::make_pair("", sidecarpatch));
+            }
+        }
+        sidecar.add_child("patches", sidecarpatches);
+        
+        ptree sidecarreferences;
+        const int indices[2] = { layout.white_index, layout.black_index };
+        for (int i = 0; i < 2; ++i) {
+            sidecarreferences.push_back(std::make_pair("", sidecar_patch(
+                chart.patches[indices[i]], reference_roi(layout, width, i), chart.colors[indices[i]], format)));
+        }
+        sidecar.add_child("references", sidecarreferences);
+    }
+    
+    // output images
+    {
+        // files are encoded while the next output quantizes
+        ImageWriter writer;
+        start_writer(writer, writer_threads(tool, outputs));
+        std::mutex reportmutex;
+        std::vector<std::pair<ImageBuf, std::string>> reports;
+        
+        auto write_output = [&](const Output& output) -> bool {
+            TraceSpan span("output", "render", output.filename.size() ? output.filename : output.format.name);
+            OutputImage image;
+            if (!render_output_image(image, chart, output.format, tool.labelname.size() ? tool.labelname : output.filename)) {
+                print_error("could not quantize image: ", image.imageBuf.geterror());
+                return false;
+            }
+            ImageBuf& imageBuf = image.imageBuf;
+            if (output.shm.size()) {
+                return write_shm(imageBuf, output.shm);
+            }
+            if (output.stream.size()) {
+                FrameStream stream;
+                if (!open_stream(stream, output.stream, tool.streamformat)) {
+                    return false;
+                }
+                bool written = write_stream(stream, imageBuf, tool.streamfps);
+                close_stream(stream);
+                return written;
+            }
+            if (output.hash.size()) {
+                imageBuf.specmod().attribute("logctool:hash", output.hash);
+            }
+            apply_encoding(imageBuf, encoding);
+            if (tool.encodereport.size()) {
+                // owned copy, the pooled buffer is recycled once written
+                ImageBuf reportBuf;
+                reportBuf.copy(imageBuf);
+                std::lock_guard<std::mutex> lock(reportmutex);
+                reports.emplace_back(std::move(reportBuf), output.filename);
+            }
+            queue_write(writer, std::move(image), output.filename);
+            return true;
+        };
+        
+        // outputs quantize concurrently, at most one per thread
+        std::vector<char> written(outputs.size(), false);
+        std::vector<std::thread> threads;
+        std::atomic<size_t> next(0);
+        size_t nencoders = outputs.size();
+        if (tool.threads > 0) {
+            nencoders = std::min(nencoders, (size_t)tool.threads);
+        }
+        const TraceJob tracejob = trace_job();
+        for (size_t t = 0; t < nencoders; t++) {
+            threads.emplace_back([&]() {
+                trace_thread("output");
+                trace_job(tracejob);
+                for (size_t i = next++; i < outputs.size(); i = next++) {
+                    written[i] = write_output(outputs[i]);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        finish_writer(writer);
+        
+        // encoded one at a time after the outputs, timings are not shared
+        for (const auto& report : reports) {
+            encode_report(report.first, report.second, encoding, tool.encodereport);
+        }
+        for (size_t i = 0; i < outputs.size(); i++) {
+            if (outputs[i].filename.size() && !writer_written(writer, outputs[i].filename)) {
+                written[i] = false;
+            }
+            if (!written[i]) {
+                tool.code = EXIT_FAILURE;
+            } else if (outputs[i].filename.size()) {
+                if (outputs[i].hash.size()) {
+                    cacheindex.hashes[outputs[i].filename] = outputs[i].hash;
+                }
+                if (files) {
+                    files->push_back(outputs[i].filename);
+                }
+            }
+        }
+    }
+    
+    // output sidecar (json) file
+    if (tool.sidecarfilename.length()) {
+        print_info("writing output sidecar (json) file: ", tool.sidecarfilename);
+        if (!write_sidecar(tool.sidecarfilename, sidecar)) {
+            print_error("could not open output sidecar (json) file: ", tool.sidecarfilename);
+        } else {
+            if (sidecarhash.size()) {
+                cacheindex.hashes[tool.sidecarfilename] = sidecarhash;
+            }
+            if (files) {
+                files->push_back(tool.sidecarfilename);
+            }
+        }
+    }
+    
+    // output cube (LUT) files
+    if (write_cube_luts(tool, colorspace, midgray, transformProcessor, lutcachekey, cacheindex, files) != EXIT_SUCCESS) {
+        tool.code = EXIT_FAILURE;
+    }
+    if (cacheindex.filename.size()) {
+        save_cache_index(cacheindex);
+    }
+    return tool.code;
+}
+
+// serve
+void parse_request(const ptree& pt, LogCTool& job)
+{
+    job.ei = pt.get<int>("ei", job.ei);
+    job.dataformat = pt.get<std::string>("dataformat", job.dataformat);
+    job.transform = pt.get<std::string>("transform", job.transform);
+    job.transformbake = pt.get<int>("transformbake", job.transformbake);
+    job.optimization = pt.get<std::string>("optimization", job.optimization);
+    job.lutfile = pt.get<std::string>("lutfile", "");
+    job.patchfile = pt.get<std::string>("patchfile", "");
+    job.outputtype = pt.get<std::string>("outputtype", job.outputtype);
+    job.outputfilename = pt.get<std::string>("outputfilename", "");
+    job.outputshm = pt.get<std::string>("outputshm", "");
+    job.width = pt.get<int>("outputwidth", job.width);
+    job.height = pt.get<int>("outputheight", job.height);
+    job.outputlinear = pt.get<bool>("outputlinear", job.outputlinear);
+    job.outputnolabels = pt.get<bool>("outputnolabels", job.outputnolabels);
+    job.outputfalsecolorcubefile = pt.get<std::string>("outputfalsecolorcubefile", "");
+    job.outputstopscubefile = pt.get<std::string>("outputstopscubefile", "");
+    job.outputinversecubefile = pt.get<std::string>("outputinversecubefile", "");
+    job.inversecubesize = pt.get<int>("inversecubesize", job.inversecubesize);
+    job.lumalutsize = pt.get<int>("lumalutsize", job.lumalutsize);
+    job.sidecarfilename = pt.get<std::string>("sidecar", "");
+    job.verifyfilename = pt.get<std::string>("verify", "");
+    job.verifytolerance = pt.get<float>("verifytolerance", job.verifytolerance);
+    job.roi = pt.get<std::string>("roi", "");
+    job.strip = pt.get<std::string>("strip", "");
+    job.labelname = pt.get<std::string>("labelname", "");
+    job.sweep = pt.get<std::string>("sweep", "");
+    job.compression = pt.get<std::string>("compression", job.compression);
+    job.tile = pt.get<std::string>("tile", job.tile);
+    job.preview = pt.get<int>("preview", 0);
+    job.previewfull = pt.get<bool>("previewfull", false);
+    job.cache = pt.get<bool>("cache", job.cache);
+    job.outputs.clear();
+    if (boost::optional<const ptree&> outputs = pt.get_child_optional("outputs")) {
+        for (const auto& item : *outputs) {
+            job.outputs.push_back(item.second.get_value<std::string>());
+        }
+    }
+}
+
+bool quit_request(const std::string& line)
+{
+    ptree request;
+    try {
+        std::istringstream iss(line);
+        read_json(iss, request);
+    } catch (const json_parser_error&) {
+        return false;
+    }
+    return request.get<std::string>("command", "render") == "quit";
+}
+
+std::string handle_request(
+    const std::string& line,
+    const LogCTool& tool,
+    Resources& resources,
+    bool& quit
+) {
+    ptree request;
+    ptree response;
+    bool parsed = true;
+    try {
+        std::istringstream iss(line);
+        read_json(iss, request);
+    } catch (const json_parser_error& e) {
+        response.put("status", "error");
+        response.put("error", e.what());
+        parsed = false;
+    }
+    if (parsed) {
+        response.put("id", request.get<std::string>("id", ""));
+        if (request.get<std::string>("command", "render") == "quit") {
+            response.put("status", "ok");
+            quit = true;
+        } else {
+            LogCTool job = tool;
+            job.serve = false;
+            job.jobid = request.get<std::string>("id", "");
+            // malformed values throw, fail the request and keep serving
+            try {
+                parse_request(request, job);
+                
+                std::vector<std::string> files;
+                int code = run(job, resources, &files);
+                response.put("status", code == EXIT_SUCCESS ? "ok" : "error");
+                response.add_child("files", sidecar_array(files));
+                if (job.outputshm.size()) {
+                    response.put("shm.name", job.outputshm);
+                    response.put("shm.width", job.width);
+                    response.put("shm.height", job.height);
+                    response.put("shm.channels", job.channels);
+                    response.put("shm.dataformat", job.dataformat);
+                }
+            } catch (const std::exception& e) {
+                response.put("status", "error");
+                response.put("error", e.what());
+            }
+        }
+    }
+    std::ostringstream oss;
+    write_json(oss, response, false);
+    return oss.str();
+}
+
+#if !defined(_WIN32)
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0 // apple, SO_NOSIGPIPE is set on the client instead
+#endif
+
+int serve_socket(const LogCTool& tool, Resources& resources)
+{
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0) {
+        print_error("could not create socket: ", tool.servesocket);
+        return EXIT_FAILURE;
+    }
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, tool.servesocket.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(tool.servesocket.c_str());
+    if (bind(server, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(server, 16) != 0) {
+        print_error("could not listen on socket: ", tool.servesocket);
+        close(server);
+        return EXIT_FAILURE;
+    }
+    // quit wakes the accept loop through a pipe, shutdown of a listener does not on apple
+    int wake[2];
+    if (pipe(wake) != 0) {
+        print_error("could not create pipe: ", strerror(errno));
+        close(server);
+        return EXIT_FAILURE;
+    }
+    print_info("serving on socket: ", tool.servesocket);
+    
+    // connections are reaped once finished, client fds are closed here only
+    struct Connection
+    {
+        std::thread thread;
+        int client;
+        std::shared_ptr<std::atomic<bool>> finished;
+    };
+    std::atomic<bool> quit(false);
+    std::list<Connection> connections;
+    auto reap = [&]() {
+        for (auto it = connections.begin(); it != connections.end(); ) {
+            if (*it->finished) {
+                it->thread.join();
+                close(it->client);
+                it = connections.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    };
+    int code = EXIT_SUCCESS;
+    int failures = 0;
+    while (!quit) {
+        pollfd fds[2] = { { server, POLLIN, 0 }, { wake[0], POLLIN, 0 } };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            print_error("could not poll socket: ", strerror(errno));
+            code = EXIT_FAILURE;
+            break;
+        }
+        if (quit || fds[1].revents) {
+            break;
+        }
+        int client = accept(server, nullptr, nullptr);
+        if (client < 0) {
+            if (quit) {
+                break;
+            }
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            // back off on resource errors, give up when they persist
+            if (++failures >= 100) {
+                print_error("could not accept on socket: ", strerror(errno));
+                code = EXIT_FAILURE;
+                break;
+            }
+            reap();
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::min(failures * 10, 500)));
+            continue;
+        }
+        failures = 0;
+        reap();
+#if defined(SO_NOSIGPIPE)
+        int nosigpipe = 1;
+        setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &nosigpipe, sizeof(nosigpipe));
+#endif
+        // requests on a connection are handled in order, connections concurrently
+        std::shared_ptr<std::atomic<bool>> finished = std::make_shared<std::atomic<bool>>(false);
+        std::thread thread([&, client, finished]() {
+            trace_thread("connection");
+            std::string buffer;
+            char data[4096];
+            ssize_t size;
+            while (!quit && (size = read(client, data, sizeof(data))) > 0) {
+                buffer.append(data, size);
+                size_t pos;
+                while ((pos = buffer.find('\n')) != std::string::npos) {
+                    std::string line = buffer.substr(0, pos);
+                    buffer.erase(0, pos + 1);
+                    if (line.empty()) {
+                        continue;
+                    }
+                    bool stop = false;
+                    std::string response = handle_request(line, tool, resources, stop);
+                    for (size_t sent = 0; sent < response.size(); ) {
+                        // disconnected clients fail the send instead of raising sigpipe
+                        ssize_t count = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                        if (count <= 0) {
+                            break;
+                        }
+                        sent += count;
+                    }
+                    if (stop) {
+                        quit = true;
+                        const char byte = 0;
+                        if (write(wake[1], &byte, 1) < 0) {
+                            print_warning("could not wake socket: ", strerror(errno));
+                        }
+                    }
+                }
+            }
+            *finished = true;
+        });
+        connections.push_back(Connection { std::move(thread), client, finished });
+    }
+    // idle clients are blocked in read, shut down to wake them
+    quit = true;
+    for (Connection& connection : connections) {
+        shutdown(connection.client, SHUT_RDWR);
+    }
+    for (Connection& connection : connections) {
+        connection.thread.join();
+        close(connection.client);
+    }
+    close(wake[0]);
+    close(wake[1]);
+    close(server);
+    unlink(tool.servesocket.c_str());
+    return code;
+}
+#endif
+
+int serve(const LogCTool& tool, Resources& resources)
+{
+    // warm glyph cache
+    {
+        ImageBuf warmBuf(ImageSpec(64, 32, 3, TypeDesc::FLOAT));
+        const float fontcolor[4] = { 1, 1, 1, 1 };
+        ImageBufAlgo::render_text(warmBuf, 0, 16, "0123456789", 16, font_path("Roboto.ttf"), fontcolor);
+    }
+    
+    if (tool.servesocket.size()) {
+#if !defined(_WIN32)
+        return serve_socket(tool, resources);
+#else
+        print_error("unix sockets are not supported on this platform: ", tool.servesocket);
+        return EXIT_FAILURE;
+#endif
+    }
+    
+    // json-lines on stdin, rendered concurrently by a worker pool
+    std::queue<std::string> requests;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool done = false;
+    
+    std::vector<std::thread> workers;
+    const int nworkers = tool.threads > 0 ? tool.threads : std::max(1u, Sysutil::hardware_concurrency() / 2);
+    for (int i = 0; i < nworkers; i++) {
+        workers.emplace_back([&]() {
+            trace_thread("serve");
+            while (true) {
+                std::string line;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition.wait(lock, [&]() { return done || !requests.empty(); });
+                    if (requests.empty()) {
+                        return;
+                    }
+                    line = requests.front();
+                    requests.pop();
+                }
+                bool quit = false;
+                std::string response = handle_request(line, tool, resources, quit);
+                {
+                    std::lock_guard<std::mutex> lock(print_mutex);
+                    std::cout << response << std::flush;
+                }
+                if (quit) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    done = true;
+                    condition.notify_all();
+                }
+            }
+        });
+    }
+    
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (done) {
+                break;
+            }
+            requests.push(line);
+            condition.notify_one();
+        }
+        // stop reading once quit is dispatched, queued requests still finish
+        if (quit_request(line)) {
+            break;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        condition.notify_all();
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
     }
+    return EXIT_SUCCESS;
 }
 
-void render_labels(
-    OIIO::ImageBuf& imageBuf,
-    const std::string& dataformat,
-    const std::string& outputfilename,
-    const std::string& right_label,
-    const std::string& transform
-) {
-    const int width  = imageBuf.spec().width;
-    const int height = imageBuf.spec().height;
-
-    const float fontsmall = height * 0.025f;
-    const float xpad = width  * 0.02f;
-    const float ybase = height - height * 0.04f;
-    const float fontcolor[4] = {1,1,1,1};
-    const std::string fontfile = font_path("Roboto.ttf");
-
-    std::string left =
-        std::string("Logctool ") + datetime() + " " +
-        Filesystem::filename(outputfilename) + " (" +
-        dataformat + " " +
-        std::to_string(width) + "x" + std::to_string(height) + ")";
-
-    if (!transform.empty()) {
-        left += " - transform: " + transform;
-    }
-
-    OIIO::ImageBufAlgo::render_text(
-        imageBuf,
-        (int)std::round(xpad),
-        (int)std::round(ybase),
-        left,
-        fontsmall,
-        fontfile,
-        fontcolor,
-        OIIO::ImageBufAlgo::TextAlignX::Left,
-        OIIO::ImageBufAlgo::TextAlignY::Center
-    );
-
-    OIIO::ImageBufAlgo::render_text(
-        imageBuf,
-        (int)std::round(width - xpad),
-        (int)std::round(ybase),
-        right_label,
-        fontsmall,
-        fontfile,
-        fontcolor,
-        OIIO::ImageBufAlgo::TextAlignX::Right,
-        OIIO::ImageBufAlgo::TextAlignY::Center
-    );
+// outputs, space separated values after --outputs are joined into one comma separated value
+std::vector<const char*> outputs_arguments(int argc, const char* argv[], std::list<std::string>& values)
+{
+    std::vector<const char*> args;
+    for (int i = 0; i < argc; i++) {
+        args.push_back(argv[i]);
+        if (std::string(argv[i]) == "--outputs" && i + 1 < argc) {
+            std::string value = argv[++i];
+            while (i + 1 < argc && argv[i + 1][0] != '-') {
+                value += std::string(",") + argv[++i];
+            }
+            values.push_back(value);
+            args.push_back(values.back().c_str());
+        }
+    }
+    return args;
 }
 
 // main
@@ -576,6 +2272,8 @@ main( int argc, const char * argv[])
     Sysutil::setup_crash_stacktrace("stdout");
 
     Filesystem::convert_native_arguments(argc, (const char**)argv);
+    std::list<std::string> outputsvalues;
+    std::vector<const char*> args = outputs_arguments(argc, argv, outputsvalues);
     ArgParse ap;
 
     ap.intro("logctool -- a set of utilities for processing logc encoded images\n");
@@ -593,23 +2291,44 @@ main( int argc, const char * argv[])
     ap.arg("--transforms", &tool.transforms)
       .help("List all transforms");
     
+    ap.arg("--threads %d:THREADS", &tool.threads)
+      .help("Number of threads for rendering, conversion and encoding (default: 0, all cores)");
+    
+    ap.arg("--trace %s:FILE", &tool.trace)
+      .help("Optional output trace (json) file of per thread spans, chrome trace event format");
+    
     ap.arg("--ei %d:EI", &tool.ei)
       .help("LogC exposure index");
     
     ap.arg("--dataformat %s:DATAFORMAT", &tool.dataformat)
-      .help("LogC format. Options: float (default), uint8, uint10, uint16, uint32");
+      .help("LogC format. Options: float (default), half, uint8, uint10, uint16, uint32");
 
     
     ap.arg("--transform %s:TRANSFORM", &tool.transform)
-      .help("LUT transform");
+      .help("LUT transform, comma separated transforms are applied in order");
+    
+    ap.arg("--transformbake %d:SIZE", &tool.transformbake)
+      .help("Bake the transform chain into one 3D LUT of size (default: 0, no bake)");
+    
+    ap.arg("--optimization %s:NAME", &tool.optimization)
+      .help("OCIO optimization of transform and quantize processors. Options: default, none, lossless, verygood, good, draft");
+    
+    ap.arg("--lutfile %s:FILE", &tool.lutfile)
+      .help("LUT file, applied after the transform");
+    
+    ap.arg("--patchfile %s:FILE", &tool.patchfile)
+      .help("Patch set (json) file, any number of patches for output type custom");
     
     ap.separator("Output flags:");
     ap.arg("--outputtype %s:OUTTYPE", &tool.outputtype)
-      .help("Output type. Options: stepchart (default), classic, digitalsg");
+      .help("Output type. Options: stepchart (default), classic, digitalsg, custom");
     
     ap.arg("--outputfilename %s:OUTFILENAME", &tool.outputfilename)
       .help("Output filename of log steps");
 
+    ap.arg("--outputs %L:OUTPUTS", &tool.outputs)
+      .help("Additional outputs rendered from the same master, as filename:dataformat, comma or space separated");
+
     ap.arg("--outputwidth %d:WIDTH", &tool.width)
       .help("Output width of log steps");
     
@@ -627,9 +2346,98 @@ main( int argc, const char * argv[])
     
     ap.arg("--outputstopscubefile %s:FILE", &tool.outputstopscubefile)
       .help("Optional output stops cube (lut) file");
+    
+    ap.arg("--outputinversecubefile %s:FILE", &tool.outputinversecubefile)
+      .help("Optional output inverse cube (lut) file, transform output to LogC3");
+    
+    ap.arg("--inversecubesize %d:SIZE", &tool.inversecubesize)
+      .help("Inverse cube (lut) size (default: 33)");
+    
+    ap.arg("--lumalutsize %d:SIZE", &tool.lumalutsize)
+      .help("Write false color and stops luts as 1D luma luts of size, .clf files include the luma matrix, .cube files are applied per channel and expect luma input (default: 0, 3D cube)");
+    
+    ap.arg("--sidecar %s:FILE", &tool.sidecarfilename)
+      .help("Optional output sidecar (json) file of rendered code values");
+    
+    ap.arg("--outputshm %s:NAME", &tool.outputshm)
+      .help("Optional output to existing POSIX shared memory, raw interleaved pixels");
+    
+    ap.arg("--outputstream %s:PATH", &tool.outputstream)
+      .help("Optional output of raw frames to a fifo or stdout (-)");
+    
+    ap.arg("--streamformat %s:FORMAT", &tool.streamformat)
+      .help("Stream format. Options: rgb48le (default), rgb24, gbrpf32, y4m");
+    
+    ap.arg("--streamfps %d:FPS", &tool.streamfps)
+      .help("Stream frame rate of y4m header (default: 24)");
+    
+    ap.separator("Encode flags:");
+    ap.arg("--compression %s:NAME", &tool.compression)
+      .help("Output compression, format dependent. Options for exr: none, rle, zips, zip, piz, pxr24, b44, dwaa, dwab (default: zip)");
+    
+    ap.arg("--tile %s:WxH", &tool.tile)
+      .help("Write tiled output with tile size, for formats with tiles");
+    
+    ap.arg("--codecthreads %d:THREADS", &tool.codecthreads)
+      .help("Number of threads per exr codec (default: --threads)");
+    
+    ap.arg("--encodereport %s:NAMES", &tool.encodereport)
+      .help("Report encode time and file size per compression, comma separated");
+    
+    ap.separator("Preview flags:");
+    ap.arg("--preview %d:SCALE", &tool.preview)
+      .help("Render a preview at 1/scale resolution to name.preview.ext, without the full render");
+    
+    ap.arg("--previewfull", &tool.previewfull)
+      .help("Render the full resolution outputs after the preview");
+    
+    ap.separator("Sweep flags:");
+    ap.arg("--sweep %s:START,END,STEP", &tool.sweep)
+      .help("Render a sequence with exposure ramped from start to end stops, #### in filenames is the frame");
+    
+    ap.separator("Region flags:");
+    ap.arg("--roi %s:X0,X1,Y0,Y1", &tool.roi)
+      .help("Render only a region of the chart, in chart coordinates");
+    
+    ap.arg("--strip %s:I/N", &tool.strip)
+      .help("Render only strip I of N horizontal strips of the chart");
+    
+    ap.arg("--labelname %s:NAME", &tool.labelname)
+      .help("Filename shown in the chart label, strips use the merged filename (default: output filename)");
+    
+    ap.arg("--merge %L:FILES", &tool.merge)
+      .help("Merge rendered strips into output filename, without rendering");
+    
+    ap.separator("Cache flags:");
+    ap.arg("--cache", &tool.cache)
+      .help("Skip outputs with a matching content hash, stored in exr, cube, clf and json outputs, else in a logctool_cache.json index next to the output");
+    
+    ap.arg("--cacheindex %s:FILE", &tool.cacheindex)
+      .help("Cache index (json) file of output hashes, overrides the default index for formats without metadata");
+    
+    ap.separator("Serve flags:");
+    ap.arg("--serve", &tool.serve)
+      .help("Serve json-lines render requests on stdin with warm resources");
+    
+    ap.arg("--servesocket %s:PATH", &tool.servesocket)
+      .help("Serve json-lines render requests on a unix socket");
+    
+    ap.separator("Characterize flags:");
+    ap.arg("--characterize %s:TRANSFORM", &tool.characterize)
+      .help("Characterize gray response, slope and clipping of a transform or lut file over -8 to +8 stops");
+    
+    ap.arg("--characterizefile %s:FILE", &tool.characterizefile)
+      .help("Characterize curve table and summary (csv or json) file");
+    
+    ap.separator("Verify flags:");
+    ap.arg("--verify %s:FILE", &tool.verifyfilename)
+      .help("Verify code values of a rendered chart of output type");
+    
+    ap.arg("--verifytolerance %f:TOLERANCE", &tool.verifytolerance)
+      .help("Verify tolerance in code values (default: 1, 0.001 for float)");
 
     // clang-format on
-    if (ap.parse_args(argc, (const char**)argv) < 0) {
+    if (ap.parse_args((int)args.size(), args.data()) < 0) {
         print_error("Could no parse arguments: ", ap.geterror());
         print_help(ap);
         ap.abort();
@@ -641,7 +2449,13 @@ main( int argc, const char * argv[])
         return EXIT_SUCCESS;
     }
     
-    if (!tool.transforms) {
+    if (tool.servesocket.size()) {
+        tool.serve = true;
+    }
+    if (tool.serve || tool.outputstream == "-") {
+        info_stream = &std::cerr; // responses and frames own stdout
+    }
+    if (!tool.transforms && !tool.serve) {
         if (!tool.ei) {
             print_error("missing parameter: ", "ei");
             ap.briefusage();
@@ -660,7 +2474,7 @@ main( int argc, const char * argv[])
             ap.abort();
             return EXIT_FAILURE;
         }
-        if (!tool.outputfilename.size()) {
+        if (!tool.outputfilename.size() && !tool.outputs.size() && !tool.outputshm.size() && !tool.outputstream.size() && !tool.verifyfilename.size() && !tool.characterize.size()) {
             print_error("missing parameter: ", "outputfilename");
             ap.briefusage();
             ap.abort();
@@ -676,863 +2490,64 @@ main( int argc, const char * argv[])
     // logc program
     print_info("logctool -- a set of utilities for processing logc encoded images");
     
-    // colorspaces
-    std::map<std::string, LutTransform> transforms;
-    std::string jsonfile = resources_path("logctool.json");
-    std::ifstream json(jsonfile);
-    if (json.is_open()) {
-        ptree pt;
-        read_json(jsonfile, pt);
-        for (const std::pair<const ptree::key_type, ptree>& item : pt) {
-            std::string name = item.first;
-            const ptree data = item.second;
-            LutTransform transform {
-                resources_path(data.get<std::string>("description", "")),
-                resources_path(data.get<std::string>("filename", "")),
-            };
-
-            if (!Filesystem::exists(transform.filename)) {
-                print_warning("'filename' does not exist for transform: ", transform.filename);
-                continue;
-            }
-            transforms[name] = transform;
-        }
-    } else {
-        print_error("could not open transforms file: ", jsonfile);
-        ap.abort();
-        return EXIT_FAILURE;
-    }
-    
-    if (tool.transforms) {
-        print_info("Transforms:");
-        for (const std::pair<std::string, LutTransform>& pair : transforms) {
-            print_info("    ", pair.first);
-        }
-        return EXIT_SUCCESS;
-    }
-    
-    if (tool.transform.size()) {
-        if (!transforms.count(tool.transform)) {
-            print_error("unknown transform: ", tool.transform);
-            ap.abort();
-            return EXIT_FAILURE;
-        }
-    }
-    
-    // logc midgray
-    float midgray = 0.18f;
-    float midlog = 0.0;
-    
-    // logc colorspace
-    LogC3Colorspace colorspace;
-    std::vector<LogC3Colorspace> colorspaces =
-    {
-        //              ei    cut       a         b         c         d         e         f
-        LogC3Colorspace() = { 160,  0.005561, 5.555556, 0.080216, 0.269036, 0.381991, 5.842037, 0.092778 },
-        LogC3Colorspace() = { 200,  0.006208, 5.555556, 0.076621, 0.266007, 0.382478, 5.776265, 0.092782 },
-        LogC3Colorspace() = { 250,  0.006871, 5.555556, 0.072941, 0.262978, 0.382966, 5.710494, 0.092786 },
-        LogC3Colorspace() = { 320,  0.007622, 5.555556, 0.068768, 0.259627, 0.383508, 5.637732, 0.092791 },
-        LogC3Colorspace() = { 400,  0.008318, 5.555556, 0.064901, 0.256598, 0.383999, 5.571960, 0.092795 },
-        LogC3Colorspace() = { 500,  0.009031, 5.555556, 0.060939, 0.253569, 0.384493, 5.506188, 0.092800 },
-        LogC3Colorspace() = { 640,  0.009840, 5.555556, 0.056443, 0.250219, 0.385040, 5.433426, 0.092805 },
-        //              800   default gamma
-        LogC3Colorspace() = { 800,  0.010591, 5.555556, 0.052272, 0.247190, 0.385537, 5.367655, 0.092809 },
-        LogC3Colorspace() = { 1000, 0.011361, 5.555556, 0.047996, 0.244161, 0.386036, 5.301883, 0.092814 },
-        LogC3Colorspace() = { 1280, 0.012235, 5.555556, 0.043137, 0.240810, 0.386590, 5.229121, 0.092819 },
-        LogC3Colorspace() = { 1600, 0.013047, 5.555556, 0.038625, 0.237781, 0.387093, 5.163350, 0.092824 }
-    };
-    for(LogC3Colorspace logccolorspace : colorspaces) {
-        if (tool.ei == logccolorspace.ei) {
-            colorspace = logccolorspace;
-            break;
+    // threads
+    if (tool.threads > 0) {
+        setThreads(tool.threads);
+        if (tool.verbose) {
+            print_info("threads: ", tool.threads);
         }
     }
-    
-    // image data
-    print_info("image data");
-    if (colorspace.ei > 0) {
-        print_info("ei: ", colorspace.ei);
+    if (tool.codecthreads > 0) {
+        OIIO::attribute("exr_threads", tool.codecthreads);
         if (tool.verbose) {
-            print_info("cut: ", colorspace.cut);
-            print_info("a: ", colorspace.a);
-            print_info("b: ", colorspace.b);
-            print_info("c: ", colorspace.c);
-            print_info("d: ", colorspace.d);
-            print_info("e: ", colorspace.e);
-            print_info("f: ", colorspace.f);
+            print_info("codec threads: ", tool.codecthreads);
         }
     }
-    else {
-        print_error("unknown ei: ", tool.ei);
-        ap.abort();
-        return EXIT_FAILURE;
-    }
     
-    // image format
-    TypeDesc typedesc = TypeDesc::UNKNOWN;
-    bool is10bit = false;
-    
-    if (tool.dataformat == "float") {
-        typedesc = TypeDesc::FLOAT;
-    }
-    else if (tool.dataformat == "uint8") {
-        typedesc = TypeDesc::UINT8;
-    }
-    else if (tool.dataformat == "uint10") {
-        typedesc = TypeDesc::UINT16;
-        is10bit = true; // 10bit stored 16bit and bitshifted in formats like DPX
+    // trace
+    if (tool.trace.size()) {
+        trace_enable();
+        trace_thread("main");
     }
-    else if (tool.dataformat == "uint16") {
-        typedesc = TypeDesc::UINT16;
-    }
-    else if (tool.dataformat == "uint32") {
-        typedesc = TypeDesc::UINT32;
-    }
-    else {
-        print_error("unknown data format: ", tool.dataformat);
+    
+    // resources
+    Resources resources;
+    if (!load_transforms(resources)) {
         ap.abort();
         return EXIT_FAILURE;
     }
     
-    // lut info
-    ConstConfigRcPtr config = Config::CreateRaw();
-    ConstCPUProcessorRcPtr transformProcessor;
-    
-    if (tool.transform.size()) {
-        LutTransform transform = transforms[tool.transform];
-        FileTransformRcPtr filetransform = FileTransform::Create();
-        filetransform->setSrc(transform.filename.c_str());
-        filetransform->setInterpolation(INTERP_BEST);
-        ConstProcessorRcPtr processor = config->getProcessor(filetransform);
-        transformProcessor = processor->getDefaultCPUProcessor();
-    }
-    print_info("filename: ", tool.outputfilename);
-    print_info("format: ", typedesc);
-    if (is10bit) {
-        print_info(" 10bit: ", "yes");
-    }
-    
-    // transform
-    if (!tool.transform.empty()) {
-        print_info("transform: ", tool.transform);
-    }
-    
-    // image data
-    int width = tool.width;
-    int height = tool.height;
-    int channels = tool.channels;
-    int imagesize = width * height * channels;
-    
-    if (tool.verbose) {
-        print_info(" width: ", width);
-        print_info(" height: ", height);
-        print_info(" channels: ", channels);
-    }
-    
-    size_t typesize = typedesc.size();
-    size_t typelimit = pow(2, typesize*8) - 1;
-    size_t type10bitlimit = pow(2, 10) - 1;
-    
-    if (tool.verbose) {
-        print_info(" typesize: ", typesize);
-        print_info(" typelimit: ", typelimit);
-        print_info(" type10bitlimit: ", type10bitlimit);
-    }
-
-    if (tool.outputtype == "stepchart") {
-        print_info("image: stepchart");
-
-        // signal
-        int signalsize = 17;
-        void* signaldata = (void*)malloc(typesize * signalsize);
-        memset(signaldata, 0, typesize * signalsize);
-        
-        print_info("signal stops: ", signalsize);
-        for(int s=0; s<signalsize; s++) {
-            int relstop = s-8;
-            float lin = pow(2, relstop) * midgray;
-            float log = 0.0;
-            
-            if (tool.outputlinear) {
-                log = lin;
-            } else {
-                log = std::min<float>(colorspace.lin2log(lin), typelimit);
-            }
-            
-            if (tool.verbose) {
-                print_info(" stop:  ", relstop);
-                print_info("   lin: ", lin);
-                print_info("   log: ", log);
-            }
-            
-            if (tool.transform.size()) {
-                float rgb[3] = { log, log, log };
-                transformProcessor->applyRGB(rgb);
-                log = rgb[0];
-                if (tool.verbose) {
-                    print_info("   lut: ", log);
-                }
-            }
-
-            if (typedesc.is_floating_point()) {
-                memcpy((char*)signaldata + typesize*s, &log, typesize);
-                if (relstop == 0) {
-                    midlog = log;
-                }
-                if (tool.verbose) {
-                    print_info("   value: ", log);
-                }
-            }
-            else {
-                int value = round(typelimit * log);
-                memcpy((char*)signaldata + typesize*s, &value, typesize);
-                if (relstop == 0) {
-                    midlog = log;
-                }
-                if (tool.verbose) {
-                    if (is10bit) {
-                        print_info("   value: ", _10bit_to_str(value));
-                    } else {
-                        print_info("   value: ", int_to_str(value));
-                    }
-                }
-            }
-        }
-        // output image
-        {
-            void* imagedata = malloc(typesize * imagesize);
-            memset(imagedata, 0, typesize * imagesize);
-            
-            // image algo
-            ImageSpec spec (width, height, channels, typedesc);
-            if (is10bit) {
-                spec.attribute("oiio:BitsPerSample", 10);
-            }
-            ImageBuf imageBuf = ImageBuf(spec, imagedata);
-            
-            // background
-            {
-                float log;
-                if (tool.outputlinear) {
-                    log = 0.0f;
-                } else {
-                    log = colorspace.lin2log(0.0f);
-                }
-                if (tool.transform.size()) {
-                    float rgb[3] = { log, log, log };
-                    transformProcessor->applyRGB(rgb);
-                    log = rgb[0];
-                }
-                ImageBufAlgo::fill(imageBuf, {log, log, log});
-            }
-            
-            int stopwidth = floor(width / signalsize);
-            void* pixeldata = (void*)malloc(typesize);
-            std::map<int, std::pair<int, float>> stops;
-            
-            for(int y=0; y<height; ++y) {
-                int stopcount=0;
-                for(int x=0; x<width; ++x) {
-                    int stop = std::min<int>(signalsize - 1, stopcount);
-                    if (((float)y / height) > 0.5) {
-                        float relstop = (((float)x / width) * (signalsize - 1)) - 8;
-                        float lin = pow(2, relstop) * midgray;
-                        float log = 0.0;
-                        if (tool.outputlinear) {
-                            log = lin;
-                        } else {
-                            log = colorspace.lin2log(lin);;
-                        }
-                        if (tool.transform.size()) {
-                            float rgb[3] = { log, log, log };
-                            transformProcessor->applyRGB(rgb);
-                            log = rgb[0];
-                        }
-                        if (typedesc.is_floating_point()) {
-                            memcpy(pixeldata, &log, typesize);
-                        } else {
-                            int value = round(typelimit * log);
-                            memcpy(pixeldata, &value, typesize);
-                        }
-                    }
-                    else {
-                        if (x % stopwidth == 0) {
-                            int stop = std::min<int>(signalsize - 1, stopcount);
-                            int relativestop = stop-8;
-                            memcpy(pixeldata, (char*)signaldata + typesize*stop, typesize);
-                            if (stops.find(relativestop) == stops.end()) {
-                                if (typedesc.is_floating_point()) {
-                                    float log = 0.0;
-                                    memcpy(&log, pixeldata, typesize);
-                                    stops[relativestop] = std::pair<int, float>(stop * stopwidth + stopwidth/2, log);
-                                } else {
-                                    int value = 0;
-                                    memcpy(&value, pixeldata, typesize);
-                                    stops[relativestop] = std::pair<int, float>(stop * stopwidth + stopwidth/2, value);
-                                }
-                            }
-                            stopcount++;
-                        }
-                    }
-                    for(int c=0; c<channels; c++) {
-                        int offset = channels * (width * y + x);
-                        memcpy((char*)imagedata + typesize*offset + typesize*c, pixeldata, typesize);
-                    }
-                }
-            }
-            
-            // labels
-            {
-                if (!tool.outputnolabels) {
-                    float fillwidth = width * 0.4;
-                    float fillheight = height * 0.2;
-                    float fillcolor[3] = { midlog, midlog, midlog };
-                    
-                    std::string font = "Roboto.ttf";
-                    float fontsmall = height * 0.025;
-                    float fontmedium = height * 0.04;
-                    float fontlarge = height * 0.08;
-                    float fontcolor[] = { 1, 1, 1, 1 };
-                    
-                    float xbegin = (width - fillwidth) / 2.0;
-                    float ybegin = (height - fillheight) / 2.0;
-
-                    ImageBufAlgo::fill(imageBuf, fillcolor,
-                        ROI(
-                            xbegin, width - xbegin, ybegin, height - ybegin
-                        )
-                    );
-                    
-                    for (std::pair<int, std::pair<int, float>> stop : stops) {
-                        int x = stop.second.first;
-                        float value = stop.second.second;
-                        ImageBufAlgo::render_text(imageBuf,
-                            x,
-                            height * 0.04,
-                            std::to_string(stop.first),
-                            fontmedium,
-                            font_path(font),
-                            fontcolor,
-                            ImageBufAlgo::TextAlignX::Center,
-                            ImageBufAlgo::TextAlignY::Center
-                        );
-                        // code and signal
-                        {
-                            std::string code, signal;
-                            if (typedesc.is_floating_point()) {
-                                code = float_to_str(value);
-                                signal = percent_to_str(value);
-                            } else {
-                                if (is10bit) {
-                                    code = _10bit_to_str(value);
-                                    signal = percent_to_str((float)_10bit_to_int(value) / type10bitlimit);
-                                } else {
-                                    code = int_to_str(value);
-                                    signal = percent_to_str(value / typelimit);
-                                }
-                            }
-                            ImageBufAlgo::render_text(
-                                imageBuf,
-                                x,
-                                height * 0.04 + fontmedium,
-                                code,
-                                fontsmall,
-                                font_path(font),
-                                fontcolor,
-                                ImageBufAlgo::TextAlignX::Center,
-                                ImageBufAlgo::TextAlignY::Center
-                            );
-                            ImageBufAlgo::render_text(
-                                imageBuf,
-                                x,
-                                height * 0.04 + fontmedium * 2,
-                                signal,
-                                fontsmall,
-                                font_path(font),
-                                fontcolor,
-                                ImageBufAlgo::TextAlignX::Center,
-                                ImageBufAlgo::TextAlignY::Center
-                            );
-                        }
-                    }
-                    
-                    ImageBufAlgo::render_text(imageBuf,
-                        width / 2.0,
-                        height / 2.0,
-                        "LogC3 Ø:" +
-                        float_to_str(midgray) +
-                        " EI:" +
-                        int_to_str(tool.ei),
-                        fontlarge,
-                        font_path(font),
-                        fontcolor,
-                        ImageBufAlgo::TextAlignX::Center,
-                        ImageBufAlgo::TextAlignY::Center
-                    );
-                    
-                    std::string logctool =
-                        "Logctool " +
-                        datetime() +
-                        " " +
-                        Filesystem::filename(tool.outputfilename) +
-                        " (" +
-                        tool.dataformat +
-                        " " +
-                        std::to_string(spec.width) +
-                        "x" +
-                        std::to_string(spec.height) +
-                        ")";
-
-                    if (!tool.transform.empty()) {
-                        logctool += " - transform: " + tool.transform;
-                    }
-                    
-                    ImageBufAlgo::render_text(
-                        imageBuf,
-                        width * 0.02,
-                        height - height * 0.04,
-                        logctool,
-                        fontsmall,
-                        font_path(font),
-                        fontcolor,
-                        ImageBufAlgo::TextAlignX::Left,
-                        ImageBufAlgo::TextAlignY::Center
-                    );
-                    
-                    ImageBufAlgo::render_text(
-                        imageBuf,
-                        width - (width * 0.02),
-                        height - height * 0.04,
-                        "stepchart",
-                        fontsmall,
-                        font_path(font),
-                        fontcolor,
-                        ImageBufAlgo::TextAlignX::Right,
-                        ImageBufAlgo::TextAlignY::Center
-                    );
-                    
-                    if (tool.transform.size()) {
-                        ImageBufAlgo::render_text(
-                            imageBuf,
-                            width / 2.0,
-                            height / 2.0 + fontlarge,
-                            "Transform: " + tool.transform,
-                            fontmedium * 0.8,
-                            font_path(font),
-                            fontcolor,
-                            ImageBufAlgo::TextAlignX::Center,
-                            ImageBufAlgo::TextAlignY::Center
-                        );
-                    }
-                }
-            }
-            print_info("writing output file: ", tool.outputfilename);
-            
-            if (!imageBuf.write(tool.outputfilename)) {
-                print_error("could not write file: ", imageBuf.geterror());
-            }
+    if (tool.transforms) {
+        print_info("Transforms:");
+        for (const std::pair<std::string, LutTransform>& pair : resources.transforms) {
+            print_info("    ", pair.first);
         }
-        
+        return EXIT_SUCCESS;
     }
-    else if (tool.outputtype == "classic") {
-        print_info("type: classic");
-        
-        // patches
-        std::vector<Patch> patches = load_patches(resources_path("classic.json"));
-        if (patches.size() != 24) {
-            print_error("could not match colorpatches 4 rows x 6 colums = 24, is now: ", patches.size());
-            ap.abort();
-            return EXIT_FAILURE;
-        }
-        
-        // output image
-        {
-            void* imagedata = (void*)malloc(typesize * imagesize);
-            memset(imagedata, 0, typesize * imagesize);
-            
-            // image buf
-            ImageSpec spec (width, height, channels, typedesc);
-            if (is10bit) {
-                spec.attribute("oiio:BitsPerSample", 10);
-            }
-            ImageBuf imageBuf = ImageBuf(spec, imagedata);
-            
-            // background
-            {
-                float log;
-                if (tool.outputlinear) {
-                    log = 0.0f;
-                } else {
-                    log = colorspace.lin2log(0.0f);
-                }
-                if (tool.transform.size()) {
-                    float rgb[3] = { log, log, log };
-                    transformProcessor->applyRGB(rgb);
-                    log = rgb[0];
-                }
-                ImageBufAlgo::fill(imageBuf, {log, log, log});
-            }
-            
-            // render
-            float spacing = width * 0.02;
-            int colorswidth = width * 0.8;
-            int patchrows = 4;
-            int patchcols = 6;
-            int patchwidth = (colorswidth - (patchcols + 1) * spacing) / patchcols;
-            int patchheight = ((height - height * 0.05) - (patchrows + 1) * spacing) / patchrows;
-            
-            int imageheight = imageBuf.spec().height;
-            float sizecode = imageheight * 0.015f;
-            float sizelabel = imageheight * 0.025f;
-            
-            render_patches(imageBuf,
-                           patches,
-                           patchrows,
-                           patchcols,
-                           patchwidth,
-                           patchheight,
-                           spacing,
-                           sizecode,
-                           sizelabel,
-                           colorspace,
-                           typedesc,
-                           is10bit,
-                           typelimit,
-                           tool.outputlinear,
-                           transformProcessor,
-                           tool.outputnolabels,
-                           true);
-            
-            int referencex = colorswidth;
-            int referenceheight = ((height - height * 0.05f) - (2 + 1) * spacing) / 2;
-            
-            render_reference_patches(
-                            imageBuf,
-                            patches,
-                            referencex,
-                            referenceheight,
-                            spacing,
-                            sizecode,
-                            sizelabel,
-                            colorspace,
-                            typedesc,
-                            is10bit,
-                            typelimit,
-                            tool.outputlinear,
-                            transformProcessor,
-                            tool.outputnolabels,
-                            18,
-                            23);
-            
-            if (!tool.outputnolabels) {
-                render_labels(
-                            imageBuf,
-                            tool.dataformat,
-                            tool.outputfilename,
-                            "colorchecker",
-                            tool.transform);
-            }
-            
-            print_info("writing output file: ", tool.outputfilename);
-            
-            if (!imageBuf.write(tool.outputfilename)) {
-                print_error("could not write file: ", imageBuf.geterror());
+    
+    int code;
+    if (tool.merge.size()) {
+        std::vector<std::string> filenames;
+        for (const std::string& merge_arg : tool.merge) {
+            for (const std::string& item : Strutil::splits(merge_arg, ",")) {
+                filenames.push_back(item);
             }
         }
+        code = merge_strips(filenames, tool.outputfilename);
     }
-    else if (tool.outputtype == "digitalsg") {
-        print_info("type: digitalsg");
-        
-        // patches
-        std::vector<Patch> patches = load_patches(resources_path("digitalsg.json"));
-        if (patches.size() != 140) {
-            print_error("could not match colorpatches 10 rows x 14 colums = 140, is now: ", patches.size());
-            ap.abort();
-            return EXIT_FAILURE;
-        }
-        
-        // output image
-        {
-            void* imagedata = (void*)malloc(typesize * imagesize);
-            memset(imagedata, 0, typesize * imagesize);
-            
-            // image algo
-            ImageSpec spec (width, height, channels, typedesc);
-            if (is10bit) {
-                spec.attribute("oiio:BitsPerSample", 10);
-            }
-            ImageBuf imageBuf = ImageBuf(spec, imagedata);
-            
-            // background
-            {
-                float log;
-                if (tool.outputlinear) {
-                    log = 0.0f;
-                } else {
-                    log = colorspace.lin2log(0.0f);
-                }
-                if (tool.transform.size()) {
-                    float rgb[3] = { log, log, log };
-                    transformProcessor->applyRGB(rgb);
-                    log = rgb[0];
-                }
-                ImageBufAlgo::fill(imageBuf, {log, log, log});
-            }
-            
-            // render
-            float spacing = width * 0.02;
-            int colorswidth = width * 0.8;
-            int patchrows = 10;
-            int patchcols = 14;
-            int patchwidth = (colorswidth - (patchcols + 1) * spacing) / patchcols;
-            int patchheight = ((height - height * 0.05) - (patchrows + 1) * spacing) / patchrows;
-            
-            int imageheight = imageBuf.spec().height;
-            float sizecode = imageheight * 0.015f;
-            float sizelabel = imageheight * 0.008f;
-            
-            render_patches(imageBuf,
-                           patches,
-                           patchrows,
-                           patchcols,
-                           patchwidth,
-                           patchheight,
-                           spacing,
-                           sizecode,
-                           sizelabel,
-                           colorspace,
-                           typedesc,
-                           is10bit,
-                           typelimit,
-                           tool.outputlinear,
-                           transformProcessor,
-                           tool.outputnolabels,
-                           false);
-            
-            int referencex = colorswidth;
-            int referenceheight = ((height - height * 0.05f) - (2 + 1) * spacing) / 2;
-
-            render_reference_patches(
-                            imageBuf,
-                            patches,
-                            referencex,
-                            referenceheight,
-                            spacing,
-                            sizecode,
-                            sizelabel,
-                            colorspace,
-                            typedesc,
-                            is10bit,
-                            typelimit,
-                            tool.outputlinear,
-                            transformProcessor,
-                            tool.outputnolabels,
-                            0,
-                            20);
-            
-            if (!tool.outputnolabels) {
-                render_labels(
-                            imageBuf,
-                            tool.dataformat,
-                            tool.outputfilename,
-                            "colorchecker",
-                            tool.transform);
-            }
-            
-            print_info("writing output file: ", tool.outputfilename);
-            
-            if (!imageBuf.write(tool.outputfilename)) {
-                print_error("could not write file: ", imageBuf.geterror());
-            }
-        }
-
-    } else {
-        print_error("unknown output type: ", tool.outputtype);
-        ap.abort();
-        return EXIT_FAILURE;
+    else if (tool.serve) {
+        code = serve(tool, resources);
     }
-    
-    // output stops cube (LUT) file
-    if (tool.outputfalsecolorcubefile.length()) {
-        print_info("writing output false color cube (lut) file: ", tool.outputfalsecolorcubefile);
-        
-        int size = 32 + 1;
-        int nsize = size * size * size;
-        std::vector<float> values;
-        
-        // table
-        std::vector<Imath::Vec4<float>> colors {
-            // purple - black clipping
-            Imath::Vec4<float>(-6, 250.0f, 0.6f, 0.6f),
-            // blue
-            Imath::Vec4<float>(-4, 200, 0.6f, 0.6f),
-            // gray
-            Imath::Vec4<float>(0 , 90.0, 0.1f, 0.5f),
-            // pink
-            Imath::Vec4<float>(1 , 330.0f, 0.8f, 0.9f),
-            // yellow
-            Imath::Vec4<float>(2.5 , 50, 0.8f, 0.9f),
-            // red - white clipping
-            Imath::Vec4<float>(6 , 5.0f, 0.6f, 1.0f),
-        };
-        
-        for (Imath::Vec4<float>& color : colors) {
-            float lin = pow(2, color[0]+0.5f) * midgray;
-            float log = std::min<float>(colorspace.lin2log(lin), 1.0f);
-            if (tool.transform.size()) {
-                float rgb[3] = { log, log, log };
-                transformProcessor->applyRGB(rgb);
-                log = rgb[0];
-            }
-            color[0] = log;
-        }
-    
-        for (unsigned i = 0; i < nsize; ++i) {
-            float r = std::max(0.0f, std::min(1.0f, static_cast<float>(i % size) / (size - 1)));
-            float g = std::max(0.0f, std::min(1.0f, static_cast<float>((i / size) % size) / (size - 1)));
-            float b = std::max(0.0f, std::min(1.0f, static_cast<float>((i / (size * size)) % size) / (size - 1)));
-            float y = 0.2126 * r + 0.7152 * g + 0.0722 * b; // use Rec709 coeff
-
-            int index = 0;
-            for (Imath::Vec4<float>& color : colors) {
-                if (y <= color[0] || index == colors.size() - 1) {
-                    Imath::Vec3<float> rgb = hsv_to_rgb(
-                        Imath::Vec3<float>(color[1], color[2], color[3])
-                    );
-                    values.push_back(pow_gamma(rgb[0], 2.2f));
-                    values.push_back(pow_gamma(rgb[1], 2.2f));
-                    values.push_back(pow_gamma(rgb[2], 2.2f));
-                    break;
-                }
-                index++;
-            }
-        }
-        
-        std::ofstream outputFile(tool.outputstopscubefile);
-        if (outputFile) {
-            outputFile << "# LogCTool False color LUT" << std::endl;
-            outputFile << "#   Input: LogC3 EI: " << tool.ei << std::endl;
-            if (tool.transform.size()) {
-            outputFile << "#        : Transform: " << tool.transform << std::endl;
-            }
-            outputFile << "#        : floating point data (range 0.0 - 1.0)" << std::endl;
-            outputFile << "#  Output: False color luminance colors" << std::endl;
-            outputFile << "#        : floating point data (range 0.0 - 1.0)" << std::endl;
-            outputFile << std::endl;
-            outputFile << "LUT_3D_SIZE " << size << std::endl;
-            outputFile << "DOMAIN_MIN 0.0 0.0 0.0" << std::endl;
-            outputFile << "DOMAIN_MAX 1.0 1.0 1.0" << std::endl;
-            outputFile << std::endl;
-            
-            for (unsigned i = 0; i < nsize; ++i) {
-                outputFile << values[i * 3] << " "
-                           << values[i * 3 + 1] << " "
-                           << values[i * 3 + 2] << std::endl;
-            }
-            outputFile.close();
-            
-        } else {
-            print_error("could not open output false color cube (lut) file: ", tool.outputfalsecolorcubefile);
-        }
-        
+    else {
+        code = run(tool, resources);
     }
-    
-    // output stops cube (LUT) file
-    if (tool.outputstopscubefile.length()) {
-        print_info("writing output stops cube (lut) file: ", tool.outputstopscubefile);
-        
-        int size = 32 + 1;
-        int nsize = size * size * size;
-        std::vector<float> values;
-        
-        // table
-        std::vector<Imath::Vec4<float>> colors {
-            // blacks
-            Imath::Vec4<float>(-8, 90.0f, 0.0f, 0.0f),
-            Imath::Vec4<float>(-7, 90.0f, 0.0f, 0.0f),
-            // purple - toe
-            Imath::Vec4<float>(-6, 270.0f, 0.6f, 0.6f),
-            Imath::Vec4<float>(-5, 270.0f, 0.4f, 0.8f),
-            // cyan
-            Imath::Vec4<float>(-4, 180.0f, 0.6f, 0.6f),
-            Imath::Vec4<float>(-3, 180.0f, 0.4f, 0.8f),
-            // green
-            Imath::Vec4<float>(-2, 90.0f, 0.6f, 0.6f),
-            Imath::Vec4<float>(-1, 90.0f, 0.4f, 0.8f),
-            // gray
-            Imath::Vec4<float>(0 , 90.0, 0.1f, 0.5f),
-            // yellow
-            Imath::Vec4<float>(1 , 60.0f, 0.8f, 0.9f),
-            Imath::Vec4<float>(2 , 60.0f, 0.6f, 1.0f),
-            // orange
-            Imath::Vec4<float>(3 , 40.0f, 0.8f, 0.9f),
-            Imath::Vec4<float>(4 , 40.0f, 0.6f, 1.0f),
-            // cerise
-            Imath::Vec4<float>(5 , 330.0f, 0.8f, 0.9f),
-            Imath::Vec4<float>(6 , 330.0f, 0.6f, 1.0f),
-            // pink
-            Imath::Vec4<float>(7 , 90.0f, 0.0f, 0.9f),
-            Imath::Vec4<float>(8 , 90.0f, 0.0f, 1.0f),
-        };
-        
-        for (Imath::Vec4<float>& color : colors) {
-            float lin = pow(2, color[0]+0.5f) * midgray;
-            float log = std::min<float>(colorspace.lin2log(lin), 1.0f);
-            if (tool.transform.size()) {
-                float rgb[3] = { log, log, log };
-                transformProcessor->applyRGB(rgb);
-                log = rgb[0];
-            }
-            color[0] = log;
-        }
-    
-        for (unsigned i = 0; i < nsize; ++i) {
-            float r = std::max(0.0f, std::min(1.0f, static_cast<float>(i % size) / (size - 1)));
-            float g = std::max(0.0f, std::min(1.0f, static_cast<float>((i / size) % size) / (size - 1)));
-            float b = std::max(0.0f, std::min(1.0f, static_cast<float>((i / (size * size)) % size) / (size - 1)));
-            float y = 0.2126 * r + 0.7152 * g + 0.0722 * b;
-
-            int index = 0;
-            for (Imath::Vec4<float>& color : colors) {
-                if (y <= color[0] || index == colors.size() - 1) {
-                    Imath::Vec3<float> rgb = hsv_to_rgb(
-                        Imath::Vec3<float>(color[1], color[2], color[3])
-                    );
-                    values.push_back(pow_gamma(rgb[0], 2.2f));
-                    values.push_back(pow_gamma(rgb[1], 2.2f));
-                    values.push_back(pow_gamma(rgb[2], 2.2f));
-                    break;
-                }
-                index++;
-            }
-        }
-        
-        std::ofstream outputFile(tool.outputstopscubefile);
-        if (outputFile) {
-            outputFile << "# LogCTool Stops LUT" << std::endl;
-            outputFile << "#   Input: LogC3 EI: " << tool.ei << std::endl;
-            if (tool.transform.size()) {
-            outputFile << "#        : Transform: " << tool.transform << std::endl;
-            }
-            outputFile << "#        : floating point data (range 0.0 - 1.0)" << std::endl;
-            outputFile << "#  Output: Stops luminance colors" << std::endl;
-            outputFile << "#        : floating point data (range 0.0 - 1.0)" << std::endl;
-            outputFile << std::endl;
-            outputFile << "LUT_3D_SIZE " << size << std::endl;
-            outputFile << "DOMAIN_MIN 0.0 0.0 0.0" << std::endl;
-            outputFile << "DOMAIN_MAX 1.0 1.0 1.0" << std::endl;
-            outputFile << std::endl;
-            
-            for (unsigned i = 0; i < nsize; ++i) {
-                outputFile << values[i * 3] << " "
-                           << values[i * 3 + 1] << " "
-                           << values[i * 3 + 2] << std::endl;
-            }
-            outputFile.close();
-            
-        } else {
-            print_error("could not open output stops cube (lut) file: ", tool.outputstopscubefile);
+    if (tool.trace.size()) {
+        print_info("writing output trace file: ", tool.trace);
+        if (!write_trace(tool.trace)) {
+            print_error("could not open output trace file: ", tool.trace);
+            code = EXIT_FAILURE;
         }
     }
-    return 0;
+    return code;
 }
+
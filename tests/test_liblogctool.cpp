@@ -0,0 +1,195 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2022 - present Mikael Sundell.
+//
+
+#include "liblogctool_internal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// openimageio
+#include <OpenImageIO/filesystem.h>
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+#include <OpenImageIO/imageio.h>
+
+using namespace OIIO;
+using namespace logctool;
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& message)
+{
+    if (!condition) {
+        std::cerr << "FAILED: " << message << std::endl;
+        failures++;
+    }
+}
+
+static std::vector<unsigned char> render(const RenderOptions& options, const std::string& type, int threads)
+{
+    setThreads(threads);
+    std::vector<unsigned char> data(imageBytes(options));
+    std::string error;
+    bool rendered = type == "stepchart"
+        ? renderStepchart(options, data.data(), data.size(), error)
+        : renderPatchChart(options, type, data.data(), data.size(), error);
+    check(rendered, type + " " + options.dataformat + " render: " + error);
+    return data;
+}
+
+// render determinism, pixels do not depend on the thread count
+static void test_threads()
+{
+    const int threads = std::max(2u, std::thread::hardware_concurrency());
+    for (const std::string type : { "stepchart", "classic", "digitalsg" }) {
+        for (const std::string dataformat : { "float", "half", "uint8", "uint10", "uint16" }) {
+            RenderOptions options;
+            options.width = 1920;
+            options.height = 1080;
+            options.dataformat = dataformat;
+            options.label = "logctool.exr";
+            std::vector<unsigned char> single = render(options, type, 1);
+            std::vector<unsigned char> multi = render(options, type, threads);
+            check(single == multi, type + " " + dataformat + " differs between 1 and "
+                  + std::to_string(threads) + " threads");
+        }
+    }
+    setThreads(0);
+}
+
+// strips, merged strips match a single render with the same label
+static void test_strips()
+{
+    const int strips = 3;
+    for (const std::string type : { "stepchart", "classic", "digitalsg" }) {
+        RenderOptions options;
+        options.width = 1920;
+        options.height = 1080;
+        options.dataformat = "uint16";
+        options.label = "logctool.exr";
+        std::vector<unsigned char> single = render(options, type, 0);
+        std::vector<unsigned char> merged(single.size());
+        const size_t rowbytes = single.size() / options.height;
+        for (int strip = 0; strip < strips; strip++) {
+            RenderOptions stripoptions = options;
+            check(strip_roi(options.width, options.height, strip, strips, stripoptions.roi),
+                  type + " strip roi " + std::to_string(strip));
+            std::vector<unsigned char> data = render(stripoptions, type, 0);
+            std::copy(data.begin(), data.end(), merged.begin() + stripoptions.roi.ybegin * rowbytes);
+        }
+        check(single == merged, type + " merged strips differ from a single render");
+    }
+}
+
+// quantize, codes of the ocio packed path match imagebufalgo::copy
+static void test_quantize()
+{
+    // ramp over every 16 bit code and half step, out of range values first
+    const int width = 65536 * 2 + 6;
+    ImageBuf masterBuf(ImageSpec(width, 1, 3, TypeDesc::FLOAT));
+    float* master = (float*)masterBuf.localpixels();
+    const float outside[6] = { -1.0f, -0.001f, 1.001f, 2.0f, 1.0f, 0.0f };
+    for (int x = 0; x < width; x++) {
+        const float value = x < 6 ? outside[x] : (x - 6) / (2.0f * 65535.0f);
+        master[x * 3] = value;
+        master[x * 3 + 1] = x < 6 ? value : 1.0f - value;
+        master[x * 3 + 2] = x < 6 ? value : value * value;
+    }
+    for (const std::string name : { "uint8", "uint10", "uint16" }) {
+        DataFormat format;
+        check(data_format(name, format), "data format: " + name);
+        ImageBuf quantizeBuf;
+        check(quantize_image(quantizeBuf, masterBuf, format), name + " quantize: " + quantizeBuf.geterror());
+        ImageSpec spec = masterBuf.spec();
+        spec.set_format(format.typedesc);
+        ImageBuf copyBuf(spec);
+        check(ImageBufAlgo::copy(copyBuf, masterBuf), name + " copy: " + copyBuf.geterror());
+        check(std::memcmp(quantizeBuf.localpixels(), copyBuf.localpixels(), spec.image_bytes()) == 0,
+              name + " codes differ between ocio and imagebufalgo::copy");
+    }
+}
+
+// mapped dpx, decoded floats match imagebuf::read(FLOAT)
+static void test_mapped()
+{
+#if !defined(_WIN32)
+    struct Case
+    {
+        std::string name;
+        int bits;
+        std::string packing;
+    };
+    const std::vector<Case> cases = {
+        { "10 bit filled method a", 10, "Filled, method A" },
+        { "10 bit filled method b", 10, "Filled, method B" },
+        { "16 bit", 16, "Filled, method A" }
+    };
+    for (const Case& c : cases) {
+        // ramp over every code, channels in different order
+        const int codes = 1 << c.bits;
+        const int width = 256;
+        const int height = codes / width;
+        ImageSpec spec(width, height, 3, TypeDesc::UINT16);
+        spec.attribute("oiio:BitsPerSample", c.bits);
+        spec.attribute("dpx:Packing", c.packing);
+        std::vector<float> ramp((size_t)width * height * 3);
+        for (int i = 0; i < width * height; i++) {
+            const float value = (float)i / (codes - 1);
+            ramp[i * 3] = value;
+            ramp[i * 3 + 1] = 1.0f - value;
+            ramp[i * 3 + 2] = (float)((i * 7) % codes) / (codes - 1);
+        }
+        const std::string filename = Filesystem::temp_directory_path() + "/"
+            + Filesystem::unique_path("logctool_%%%%%%%%.dpx");
+        std::unique_ptr<ImageOutput> output = ImageOutput::create(filename);
+        check(output && output->open(filename, spec) && output->write_image(TypeDesc::FLOAT, ramp.data())
+              && output->close(), c.name + " write: " + filename);
+        
+        ImageBuf mappedBuf;
+        std::shared_ptr<void> buffer;
+        check(read_mapped(filename, mappedBuf, buffer), c.name + " mapped read: " + filename);
+        ImageBuf readBuf(filename);
+        check(readBuf.read(0, 0, true, TypeDesc::FLOAT), c.name + " read: " + readBuf.geterror());
+        if (mappedBuf.initialized() && readBuf.initialized()) {
+            check(mappedBuf.spec().width == width && mappedBuf.spec().height == height
+                  && mappedBuf.nchannels() == readBuf.nchannels(), c.name + " mapped spec differs");
+            const float* mapped = (const float*)mappedBuf.localpixels();
+            const float* read = (const float*)readBuf.localpixels();
+            // below half a 16 bit code, same code after scaling
+            float maxdelta = 0.0f;
+            for (size_t i = 0; i < ramp.size(); i++) {
+                maxdelta = std::max(maxdelta, std::abs(mapped[i] - read[i]));
+            }
+            check(maxdelta < 0.5f / 65535.0f, c.name + " mapped values differ from read, max delta "
+                  + std::to_string(maxdelta));
+        }
+        std::string error;
+        Filesystem::remove(filename, error);
+    }
+#endif
+}
+
+int main(int argc, const char* argv[])
+{
+    if (argc > 1) {
+        setResourcesPath(argv[1]);
+    }
+    test_threads();
+    test_strips();
+    test_quantize();
+    test_mapped();
+    if (failures) {
+        std::cerr << failures << " failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}